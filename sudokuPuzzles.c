@@ -1,512 +1,6951 @@
-/*********************************************************************************************************************/
-/* Sudoku puzzle solver by Simon Ghyselincks
- * sghyselincks@gmail.com
- * Jan 3rd 2021
- *
- *  Creates a pseudo-random solvable Sudoku puzzle with a unique solution and prints it.
- *  When prompted by the user it will then display the unique solution.
- *
- *  The user can define the board as SIZE 4, 9, or 16  (size 25 is too complex for this program to compute)
- *  When using size 16 boards, limit the empty cells MAX_EMPTY to 130 to avoid overly-long computation
- *  
- *  There is a Sudoku puzzle solver built into the program that can also be used to solve externally generated cases
- *
- *  The Sudoku solution board is generated using a recursive backtracking algorithm that substitutes a random integer
- *  into an empty cell and checks if it will lead to a solution.
- *
- *  The Sudoku puzzle is generated from a solution board by emptying random position cells until
- *  there are no longer any cells that can be emptied that would still lead to a unique solution
- *
- *  The number of solutions on a sudoku board is checked through a recursive backtracking algorithm that
- *  takes the sum of all complete boards that can be reached from the current board state
- *
- */
-
-#define _CRT_SECURE_NO_WARNINGS
-
-#include <stdlib.h>
-#include <stdio.h>
-#include <math.h>
-#include <time.h>
-#include <Windows.h>
-
-#define TRUE 1
-#define FALSE 0
-#define EMPTY 0 // Placeholder for empty Sudoku board positions
-
-#define SIZE 9  //The order of magnitude of the board  Always a squared value.. 2^2, 3^2, 4^2
-
-/* This value is needed for a board size of 16, specifies how many empty cells to leave in a puzzle
- * Try values of 130-135 combined with 16x16 Sudoku Boards
- */
-#define MAX_EMPTY 81 // the maximum number of empty cells for a puzzle generated
-
-// Global backtrack counter for tracking solution branches
-int backtrackCount = 0;
-
-/* Function prototypes */
-
-/* Puzzle Generation */
-int generateBoard(int board[][SIZE]);
-int randomFillBoard(int board[][SIZE]);
-int generatePuzzle(int board[][SIZE], int solution[][SIZE]);
-
-/* Functions manipulating Sudoku boards */
-void duplicateBoard(int read[][SIZE], int write[][SIZE]);
-void printBoard(int board[][SIZE]);
-int solveBoard(int board[][SIZE], int solution[][SIZE]);
-
-/* Funtions operating on Sudoku cell values */
-int nextEmpty(int board[][SIZE], int* add_xVal, int* add_yVal);
-int getValidIntegers(int board[][SIZE], int xPos, int yPos, int validIntegers[SIZE]);
-void permittedValue(int board[][SIZE], int xPos, int yPos, int permitted[SIZE+1]);
-
-/* A list shuffling function */
-void shuffleValues(int list[SIZE], int listSize);
-
-
-int main(void) {
-	// A test case provided for debugging solving methods
-	//int testCase[SIZE][SIZE] = {0,2,0,0,0,0,0,0,0,
-	//							0,0,0,6,0,0,0,0,3,
-	//							0,7,4,0,8,0,0,0,0,
-	//							0,0,0,0,0,3,0,0,2,
-	//							0,8,0,0,4,0,0,1,0,
-	//							6,0,0,5,0,0,0,0,0,
-	//							0,0,0,0,1,0,7,8,0,
-	//							5,0,0,0,0,9,0,0,0,
-	//							0,0,0,0,0,0,0,4,0};	
-
-	/* seed the random number generator with the current time */
-	srand(time(NULL));
-
-	/* Create arrays to hold puzzle and solution */
-	int solution[SIZE][SIZE] = { 0 };   // A completed Sudoku problem
-	int puzzle[SIZE][SIZE] = { 0 };     // A Sudoku puzzle
-
-	/* user input functionality*/
-	char pressEnter = '\n';
-	
-
-	/* First we generate a random and complete solution board */
-	if (!generateBoard(puzzle))
-		printf("Warning, error generating a Sudoku puzzle.\n");
-
-	/* Make a Sudoku puzzle from a complete board by removing cells until
-	 * the further removal of any cell on the board would result in a 
-	 * non-unique solution.
-	 */ 	
-	int emptyCells = generatePuzzle(puzzle, solution);
-	   
-	/* Print the problem board */
-	printBoard(puzzle);
-	printf("\n\n");
-
-	/* Wait for user input before displaying a solution */
-	printf("There are %d cells already filled in on this Sudoku board.\n", SIZE*SIZE - emptyCells);
-	printf("Press ENTER to display the solution.\n");
-    scanf("%c", &pressEnter);
-
-	/* Display the solution to the puzzle*/
-	printBoard(solution);
-	printf("\n\n");
-
-	return 0;
-}
-
-/* Generate a blank Sudoku board and then fill it with randomized 
- *  legal values, return 1 if successful
- */
-
-int generateBoard(int board[][SIZE]) {
-
-	//initialize the board with 0s
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
-			board[i][j] = 0;
-		}
-	}
-
-	randomFillBoard(board); // Fill the empty board with random values
-
-	return 1; // return 1 if successful
-}
-
-/* Fill a Sudoku board with pseudo-random values using recursive backtracking.
- * All filled cells must be legal within the rules of Sudoku.
- *
- * Input: an empty or partially filled Sudoku board
- * Output: Return TRUE if board has been filled, 
- *         FALSE if the board is unsolvable (no legal moves)
- */
-
-int randomFillBoard(int board[][SIZE]) {
-	int xPos = 0; // Column index of a Sudoku cell
-	int yPos = 0; // Row index of a Sudoku cell
-	
-	int validIntegers[SIZE] = { 0 }; // List of valid integers for a cell in randomized order 
-	int listSize;  // The number of items in a list of valid integers
-
-	int solved = FALSE; // Indicates if the board has been completely filled with legal values
-
-	if ( !(nextEmpty(board, &xPos, &yPos)) ){ // Find the next empty cell on the board,
-											 // If there are no more empty cells
-		solved = TRUE;                       // Then the board has been completed (solved) 
-
-	}else{ // The board isn't solved yet so continue solving
-
-		// Next, get a list of permitted values for the empty cell, if there are no
-		// Permitted values, then the board is unsolvable, return FALSE
-		listSize = getValidIntegers(board, xPos, yPos, validIntegers);
-		if (listSize <= 0) {
-			// No valid integers, the board is unsolvable
-			solved = FALSE;
-		}
-		else {  // There are valid integers for substitution, try substituting each one until solution found
-			
-			// Shuffle the list of valid integers to ensure randomness
-			shuffleValues(validIntegers, listSize);
-
-			/* Try putting each legal value int the list into the empty Sudoku cell 
-			 * until a solution is found (while !solved), use recursion with backtracking here
-			 */
-			for (int i = 0; i < listSize && !solved; i++) { 
-
-				/* Replace the empty position with a shuffled valid integer */
-				board[yPos][xPos] = validIntegers[i];
-				
-				/* This is the recursion step to make sure the substitution leads to a solution*/
-				solved = randomFillBoard(board);  
-
-				/* if there is no solution found for this branch, then it is important to replace the Sudoku cell
-				 * with an EMPTY value, since the array is shared across all iterations of the function
-				 */
-				if (!solved) {
-					board[yPos][xPos] = EMPTY;
-				}				
-			}
-		}
-	}
-	return solved;
-}
-
-/*  Takes a completed and legal Sudoku board and removes random cells from it until there 
- *  is only one unique solution to the puzzle. Uses a list of all the cells on the board, 
- *  numbered from 0 - SIZE^2 - 1 -- e.g. for a 9x9 board there are 81 positions numbered from 0 - 80
- *   
- *    i. e.  0  1  2  |  3  4  5  |  6  7  8
- *           9  10 11 |  12 13 14 |  15 16 17
- *           . . . . . . . . . . . . . . . . 
- *           72 73 74 |  75 76 77 |  78 79 80
- *
- *  Removes numbers one at a time until the next removal would result in a non unique-solution puzzle
- *  
- *  Returns the value of the number of cells that were emptied from the solution to form the puzzle
- */
-
-int generatePuzzle(int board[][SIZE], int solution[][SIZE]) {
-
-	int cellNumber;  // A number representing a Sudoku cell from 0 - SIZE^2
-	int listOfCells[SIZE*SIZE] = { 0 };  // A list of numbered cell values
-
-	int xPos; // The x position of a Sudoku cell
-	int yPos; // The y position of a Sudoku cell
-	int cellValue; // The value read from a Sudoku cell
-
-	int removedCount = 0;  // Count how many cells have been successfully emptied from the full board
-	int solutions = 0;  // Tracks the solutions found by removing the number
-
-	// Initialize the list
-	for (int i = 0; i < SIZE*SIZE; i++) {
-		listOfCells[i] = i;
-	}
-
-	// Shuffle the list to randomize order
-	shuffleValues(listOfCells, SIZE*SIZE);
-
-	// Empty the cell values in the list one by one until a unique-solution puzzle has been made.
-	int index = 0;
-	while (index < SIZE*SIZE &&  removedCount < MAX_EMPTY) {
-		
-		cellNumber = listOfCells[index]; // Draw the next randomized cell postion from the list
-
-		// Convert the cellNumber to an {x,y} postion on the board
-		yPos = (cellNumber / SIZE);  //Integer division conveniently yields the y position
-		xPos = (cellNumber % SIZE);  //And the remainder is the x postion
-
-		// Try removing the cell to see if removing it prevents a unique solution, while holding removed value in memory
-		cellValue = board[yPos][xPos];
-		board[yPos][xPos] = EMPTY;
-
-		// Determine number of potential solutions after emptying the most recent cell
-		solutions = solveBoard(board, solution);
-
-		// If there is more than one solution now, the cell can't be removed without violating
-		// creating a unique solution.  Replace the cell's value and continue the loop
-		if (solutions > 1) {      
-			board[yPos][xPos] = cellValue;							
-		}
-		else {
-			removedCount++;
-		}
-		index++;		
-	}
-	return removedCount;
-}
-
-
-/* Duplicates a Sudoku board value for value reading from read[][], writing to write[][]*/
-void duplicateBoard(int read[][SIZE], int write[][SIZE]) {
-
-	for (int i = 0; i < SIZE; i++) {
-		for (int j = 0; j < SIZE; j++) {
-			write[i][j] = read[i][j];
-		}
-	}
-}
-
-/* Displays a formatted rendering of the Sudoku board for viewing in the console
- * Formatting lines indicate the sub-square boundaries
- */
-void printBoard(int board[][SIZE]) {
-
-	// Calculate the length of a subsquare (number of positions)
-	int subSquareLength = (int)sqrt(SIZE);
-
-	for (int i = 0; i < SIZE; i++) {
-
-		//This section inserts a horizontal line of suitable length to visually divide the subsquares
-		if (i % subSquareLength == 0 && i > 0) {    // Determine if a horizontal line should be inserted
-			for (int space = 0; space < SIZE; space++) {  //Fill it with dashes
-				printf("---");
-			}
-			//Add extra dashes to account for the vertical sub-square lines inserted
-			for (int space = 0; space < subSquareLength - 1; space++) {  
-				printf("---");
-			}
-			printf("\n"); // Line break to start new row
-		}
-
-		// The numerical values are filled in with vertical line breaks for each subsquare division
-		for (int j = 0; j < SIZE; j++) {
-			if (j % subSquareLength == 0 && j > 0) {  // Determine if vertical line needed
-				printf("  |");
-			}
-			printf("%3d", board[i][j]);
-		}
-
-		printf("\n");  // Line break to start new row
-	}
-}
-
-/* Given an array of Sudoku values, this function will return total number of solutions, 0 if a solution has not been found
- * It is recursive with backtracking.  Finds the index of the next empty value in the array and
- * tries all possible combinations with it.  Returns 0 if no solution exists.
- */
-int solveBoard(int board[][SIZE], int solution[][SIZE]) {
-
-	// Track the total solutions reachable from this node
-	int totalSolutions = 0;
-
-	/* The {x, y} coordinates of a cell in the Sudoku puzzle */
-	int xPos;
-	int yPos;
-	int validIntegers[SIZE] = { 0 }; // A list of which integers are valid options to substitute into an empty Sudoku cell
-	int listSize = 0; // The number of legal integers that can be used to fill a cell
-
-	if (nextEmpty(board, &xPos, &yPos)) {  //Find the next empty Sudoku cell, if there is one then continue
-
-		listSize = getValidIntegers(board, xPos, yPos, validIntegers);
-		if (listSize > 0) { //Check if the empty position has any legal integer values
-
-			for (int i = 0; i < listSize; i++) {  // Loop to check all the permitted values for potential solutions				
-
-				board[yPos][xPos] = validIntegers[i];  // Fill the cell with a valid integer from the list
-
-				// Recursive step here, checks for all possible solutions descending from the the cell
-				totalSolutions += solveBoard(board, solution); // Add the solutions from each branch to the total	
-
-				board[yPos][xPos] = EMPTY; // Fill the cell with the previous EMPTY value
-
-				backtrackCount++;          // track how many nodes visited
-			}
-		}
-
-		else {  // No legal values to complete the empty cell, zero solutions from this terminating branch
-			totalSolutions = 0;
-		}
-	}
-	else { // No more empty values, the board has been solved
-		if (totalSolutions == 0) {  //If this is the first solution that has been found (no other solved cases) save to solution
-			duplicateBoard(board, solution);  // save the solution board
-		}
-		totalSolutions++; // Add this terminating branch as a valid solution
-	}
-	return totalSolutions;
-}
-
-/* Find the x and y coordinate values of the next available empty position in the Sudoku board.
- * if there are no more empty positions, then the function returns FALSE (puzzle has been solved).
- * otherwise the coordinates are returned by array { xValue, yValue }
- */
-int nextEmpty(int board[][SIZE], int* add_xVal, int* add_yVal) {
-	int found = FALSE;  //Tracks if an empty value has been found yet
-	int xVal = 0;
-	int yVal = 0;
-
-	// Scan row by row, when coordinates of EMPTY are found it will freeze the x-y vals by exiting the loop
-	while (!found && yVal < SIZE) {
-
-		while (!found && xVal < SIZE) {
-			if (board[yVal][xVal] == EMPTY) {
-				found = TRUE;
-			}
-			else {
-				xVal++;  // Try the next value if previous wasn't EMPTY
-			}
-		}
-		
-		if (!found) {  //If an empty value wasn't found in the last row of values
-			yVal++;    //Try the next row and
-			xVal = 0;  //Reset row position
-		}
-	}
-
-	// Pass by pointer the values to the calling function
-	if (found) {
-		*add_xVal = xVal;
-		*add_yVal = yVal;
-	}
-	return found;
-}
-
-/* Populate a list of all possible legal integers to fill a Sudoku cell based on the surrounding values of the cell
- * Inputs: - board - a Sudoku board
- *		   - xPos, yPos - The coordinates of the Sudoku cell to be inspected
- *         - validIntegers - The array to store the list of values in
- *
- * Output: - (implicit) The values are stored in validIntegers which can be accessed by the calling function
- *	       - intIndex - The total number of valid integer options found for the Sudoku cell, returns 0 if no legal moves
- */		   
-
-int getValidIntegers(int board[][SIZE], int xPos, int yPos, int validIntegers[SIZE]) {
-	int permitted[SIZE + 1] = { 0 }; // Array to store the permission values found with permittedValue()
-
-	/* Test every possible integer for the cell if it is a legal move or not
-	 * permitted[] is populated with TRUE/FALSE values for each index matching 
-	 * a possible integer to fill a cell, indicating if the integer is a legal move.
-	 */
-	// Retrieve the list of permissions for the Sudoku cell
-	permittedValue(board, xPos, yPos, permitted);
-
-	int permitIndex = 1;  // Start at index 1 of the permittedValues array
-	int intIndex = 0;     // Start at 0 index for the array of integer values
-	do {
-		if (permitted[permitIndex])
-		{ // Since the permission index represents the integer, add that index to the list
-			validIntegers[intIndex] = permitIndex;
-			intIndex++;
-		}
-		permitIndex++;
-	} while (permitIndex <= SIZE);  // Scan all values in the permissions array	 
-
-	return intIndex; // The total number of valid integers is equal the final value of intIndex
-}
-
-/* Inspects a cell on a Sudoku board and verifies which integer values might be permitted in that Sudoku cell
- * Checks the column, row, and square of that Sudoku cell to remove invalid integer options 
- * Input : board - a solved or unsolved Sudoku board
- *         coords - the coordinates of the Sudoku cell to be inspected
- *         permitted - an array of TRUE or FALSE values that will record and return results
-					   The array represents valid integer options as yielding a TRUE value at
-					   the index of that integer.
- *
- * Output : (implicit) permitted[] -  records which integers can be legally substituted into a board position
- *          the integer of the array index position is the integer value in question, TRUE means it is permitted
- */         
-
-void permittedValue(int board[][SIZE], int xPos, int yPos, int permitted[SIZE+1]) {
-	int scannedVal;
-	int valid = FALSE;  // Value indicating if there are any permitted values
-
-	// Values to bound the Sudoku sub-square that the coordinate belongs to
-	int xMin, xMax, yMin, yMax;
-	// The size of a sub-square
-	int squareSize = sqrt(SIZE);
-
-	// Configure the permitted[] array to read TRUE for all integers (not including zero) to start
-	for (int i = 1; i < SIZE + 1; i++) {
-		permitted[i] = TRUE;
-	}
-	permitted[EMPTY] = FALSE; // The 0 EMPTY cell value is not a legal option
-
-	// Scan the row of the position to check value
-	for (int xval = 0; xval < SIZE; xval++) {
-		// Find the integer value of one of the completed numbers in the row
-		scannedVal = board [yPos] [xval];
-		// Exclude that number form the permitted values
-		permitted[scannedVal] = FALSE;
-	}
-
-	// Scan the column of the position to eliminate values not permitted
-	for (int yval = 0; yval < SIZE; yval++) {
-		// Find the integer value of one of the completed numbers in the column
-		scannedVal = board [yval] [xPos];
-		// Exclude that number form the permitted values
-		permitted[scannedVal] = FALSE;
-	}
-
-	// Define the sub-square that the coordinate postion occupies
-	// sub-square position is found by integer division, multiplication converts to the proper board position
-	xMin = (xPos / squareSize) * squareSize;  
-	xMax = xMin + squareSize - 1;
-	yMin = (yPos / squareSize) * squareSize;
-	yMax = yMin + squareSize - 1;
-
-	//Find any already used integers from the Sudoku sub-square
-	for (int i = yMin; i <= yMax; i++) {
-		for (int j = xMin; j <= xMax; j++) {
-			scannedVal = board[i][j];
-			permitted[scannedVal] = FALSE;
-		}
-	}
-}
-
-/* Take an ordered list of integers and shuffle the values into a randomly ordered list 
- * A list is defined as a string of integers of size listSize, with the last item of the
- * placed at index [listSize - 1] since the list items start at index 0.
- *
- */
-void shuffleValues(int list[SIZE], int listSize) {
-
-	int randomIndex; // A randomly selected index 
-	int completedIndex = 0; // The index of items that have been successfully shuffled
-	int listItem;  // The current list item selected in the shuffling process
-
-	do {
-		//Select a random index that covers the first listSize number of items in the array
-		randomIndex = rand() % listSize;
-
-		// Use the random index to draw one item from the list
-		listItem = list[randomIndex];
-
-		/* Scratch the value from the list
-		 * Start at the randomIndex and overwrite each value in the list with the
-		 * next value in the list
-		 */
-		for (int i = randomIndex; i < listSize; i++) {
-			list[i] = list[i + 1];
-		}
-
-		// Reduce the unshuffled listSize by one since an item is removed
-		listSize--;
-
-		// Place the removed list item back in the array in the newly vacated spot
-		list[listSize] = listItem;
-
-		// Increment completedIndex, an item was added to the shuffled deck
-		completedIndex++;
-
-	} while (listSize > 0); //Continue until the entire list is shuffled
-}
-
+/*********************************************************************************************************************/
+/* Sudoku puzzle solver by Simon Ghyselincks
+ * sghyselincks@gmail.com
+ * Jan 3rd 2021
+ *
+ *  Creates a pseudo-random solvable Sudoku puzzle with a unique solution and prints it.
+ *  When prompted by the user it will then display the unique solution.
+ *
+ *  The user can define the board as SIZE 4, 9, or 16  (size 25 is too complex for this program to compute)
+ *  When using size 16 boards, limit the empty cells MAX_EMPTY to 130 to avoid overly-long computation
+ *  Both can also be set when compiling, e.g. -DSIZE=16 -DMAX_EMPTY=130
+ *  
+ *  There is a Sudoku puzzle solver built into the program that can also be used to solve externally generated cases
+ *
+ *  The Sudoku solution board is generated using a recursive backtracking algorithm that substitutes a random integer
+ *  into an empty cell and checks if it will lead to a solution.
+ *
+ *  The Sudoku puzzle is generated from a solution board by emptying random position cells until
+ *  there are no longer any cells that can be emptied that would still lead to a unique solution
+ *
+ *  The number of solutions on a sudoku board is checked through a backtracking algorithm that
+ *  takes the sum of all complete boards that can be reached from the current board state. The search keeps its
+ *  levels on an explicit stack inside a solver context, whose memory is one block supplied by the caller and
+ *  sized by solverWorkspaceSize(), so solving never allocates.
+ *
+ *  The rules of the puzzle are described as a set of all-different regions (rows, columns, sub-squares and any
+ *  extra regions of a variant such as X-Sudoku, Windoku or Jigsaw). The regions are compiled once into per-cell
+ *  tables of peer cells so that the legal values of a cell are found with a handful of bitmask operations.
+ *  Both the solver and the board filler always branch on the empty cell with the fewest legal values, and the
+ *  solver first places any integer that has only one possible cell left in a region (a hidden single).
+ *
+ *  Samurai puzzles are five overlapping grids sharing their corner sub-squares. They are solved and generated
+ *  as one board whose shared cells belong to the regions of two grids, so uniqueness is checked in one search.
+ *
+ *  Large orders of puzzles are filled by worker threads (runOrder). Each thread keeps its own copy of the rules
+ *  and its own random number generator, and a scheduler steers the threads toward the buckets of the order that
+ *  are the most expensive to fill.
+ *
+ *  Generation can also run as a pipeline (runPipeline): grid filling, hole digging and grading each run on their
+ *  own threads, passing puzzles through bounded lock-free queues to a single writer that puts them back in order.
+ *  Every puzzle draws its random numbers from its own index, so the output is the same for any thread counts.
+ *  The same indexing lets a run be split into shards made by separate processes (runShard) and merged back
+ *  (runMerge) into exactly the output of one pipeline, with no communication between the shards.
+ *  On Linux a coordinator process (runCoordinator) can instead hand out units of a run to worker processes over
+ *  a Unix domain socket, giving the units of dead or slow workers to others.
+ *  The same machinery runs a solve service (runService) that gathers the requests of many clients arriving
+ *  within a few microseconds into batches for a pool of solver threads. Solutions are cached by the canonical
+ *  form of a board (canonicalForm), so a puzzle seen before relabeled, rotated or reflected is answered at once.
+ *  Other processes can take the puzzles of a pipeline without parsing text from a ring in POSIX shared memory
+ *  (runPublish), reading them in place in sequence with a cursor of their own that the publisher waits for.
+ *  A store on disk (runStore) keeps puzzles for later in an append-only data file with a mapped index by grade,
+ *  clue count and symmetry, and hands each tenant unused puzzles of a kind.
+ *  Files of boards are mapped into memory and split at line ends into chunks that threads read in place and
+ *  solve (runSolveFile).
+ *  With PERF_COUNTERS the pipeline counts hardware events around each phase (perfBegin) for every puzzle.
+ *  With TRACE_SPANS each thread records spans of its work (traceBegin) for a Chrome trace written at exit.
+ *  With SEARCH_PROFILE the solver keeps histograms of the shape of its search trees (searchProfile).
+ *  The generators count their uniqueness checks and removals (generationStats), which runTelemetry reports for
+ *  every puzzle of a batch along with the distributions over the batch. The kernels of the solver are timed on
+ *  their own by microbenchmarks (runBench), built once for each SIZE, which also time whole puzzles with fixed
+ *  seeds and threads and can check the results against a saved baseline (benchCompare).
+ *
+ *  Killer puzzles add cages, groups of cells that must hold different integers adding up to the cage sum.
+ *  The digit sets that can reach every (sum, cell count) are tabulated at startup so a cage only ever costs
+ *  a table lookup intersected with the candidates of a cell.
+ *
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#if defined(__linux__)
+#define _GNU_SOURCE              // For ppoll(), the timer of the solve service
+#elif !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L  // For the file and process calls of the operating system, see truncateFile()
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+#if defined(_WIN32)
+#include <Windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>   // For parseCells(), 16 cells at a time
+#endif
+
+#define TRUE 1
+#define FALSE 0
+
+/* Storage that every thread has its own copy of */
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+#define EMPTY 0 // Placeholder for empty Sudoku board positions
+
+#ifndef SIZE
+#define SIZE 9  //The order of magnitude of the board  Always a squared value.. 2^2, 3^2, 4^2
+#endif
+
+/* This value is needed for a board size of 16, specifies how many empty cells to leave in a puzzle
+ * Try values of 130-135 combined with 16x16 Sudoku Boards
+ */
+#ifndef MAX_EMPTY
+#define MAX_EMPTY 81 // the maximum number of empty cells for a puzzle generated
+#endif
+
+/* Strategies for making a puzzle out of a solution board */
+#define DIG_HOLES 0  // Empty random cells one at a time while the solution stays unique (generatePuzzle)
+#define BUILD_UP 1   // Add clues that rule out other solutions until the solution is unique (generatePuzzleBuildUp)
+#define BATCH_REMOVAL 2  // Like DIG_HOLES, but check blocks of cells at once and bisect failed blocks (generatePuzzleBatched)
+
+#define GENERATION_STRATEGY DIG_HOLES  // The strategy used by the program
+#define PRUNE_CLUES TRUE               // BUILD_UP: also remove the clues that turned out to be redundant
+#define BATCH_START 8                  // BATCH_REMOVAL: the number of cells in the first block
+#define BATCH_MAX 64                   // BATCH_REMOVAL: the largest block
+
+#define PUZZLES_PER_GRID 1  // The number of puzzles made from each solution board (see generatePuzzleFromGrid)
+
+/* Difficulty grades of a puzzle, found by gradePuzzle() */
+#define EASY 0    // Solved by filling cells that have a single legal integer
+#define MEDIUM 1  // Also needs integers that have a single possible cell in a region
+#define HARD 2    // Can't be solved with those two techniques alone
+#define GRADES 3
+
+/* Symmetry classes of the pattern of clues of a puzzle, the strongest symmetry kept by it, see symmetryClass() */
+#define NO_SYMMETRY 0  // None
+#define MIRROR 1       // A reflection
+#define ROTATIONAL 2   // A half turn
+#define QUARTER 3      // A quarter turn
+#define SYMMETRY_CLASSES 4
+
+const char* gradeNames[GRADES] = { "easy", "medium", "hard" };
+const char* symmetryNames[SYMMETRY_CLASSES] = { "none", "mirror", "rotational", "quarter" };
+
+/* The characters of a board written as one line of text: one character per cell, the integer 10 is written
+ * as A, 11 as B and so on, empty cells are written as . and inactive cells (SAMURAI) as #
+ */
+const char* cellChars = ".123456789ABCDEFGHIJKLMNOP";
+#define INACTIVE_CHAR '#'
+
+#define MAX_BUCKETS 32   // The most buckets in an order for runOrder()
+#define MAX_THREADS 64   // The most worker threads
+#define CHECKPOINT_SECONDS 30  // How often an order with a log saves its checkpoint
+#define MAX_PATH_LENGTH 1024
+
+#define MAX_SHARDS 1024  // The most shards runMerge() combines
+
+#define MAX_WORKERS 64              // The most worker processes connected to a coordinator at once
+#define UNIT_TIMEOUT_SECONDS 60     // A unit held longer than this is also given to an idle worker
+
+#define MAX_CLIENTS 64                   // The most clients connected to the solve service at once
+#define SERVICE_WINDOW_MICROSECONDS 200  // How long the solve service waits to fill a batch after its first request
+#define MAX_CLIENT_OUTPUT (1 << 20)      // Answers queued for a client beyond which it isn't read until it takes them
+#define MAX_BATCH 256                    // The most requests in one batch of the solve service
+#define CACHE_ENTRIES 65536              // The solutions the solve service keeps by default
+#define CACHE_SHARDS 16                  // Separately locked parts of the cache, chosen by the hash of a board
+
+#define SHARED_RING_SLOTS 4096  // The puzzles a shared memory ring holds, a power of 2
+#define MAX_CONSUMERS 16        // The most consumers reading a shared memory ring
+#define STORE_MAGIC 0x53544F52U
+#define STORE_BUCKETS (GRADES * (GRID_CELLS + 1) * SYMMETRY_CLASSES)  // Index lists of a store, see storeBucket()
+
+#define CHUNK_BYTES (1 << 20)   // The size of the pieces a file of boards is split into for the solver threads
+
+#define BENCH_BOARDS 64             // The boards the microbenchmarks cycle through, see runBench()
+#define BENCH_SAMPLES 21            // Timed samples of each microbenchmark after its warmup
+#define BENCH_SAMPLE_SECONDS 0.01   // The length of a sample, the warmup finds how many operations fill it
+#define BENCH_SEED 1                // The seed of the boards and puzzles, the same in every build of a SIZE
+#define BENCH_PUZZLES 200           // The puzzles made and solved on one thread to time generation and solving
+#define BENCH_SOLVE_REPEATS 10      // The times each of them is solved, for a measurable time
+#define BENCH_PIPELINE_PUZZLES 500  // The puzzles of the benchmark pipeline
+#define BENCH_GRID_THREADS 1        // and its thread counts, fixed so runs are comparable
+#define BENCH_DIG_THREADS 2
+#define BENCH_GRADE_THREADS 1
+#define BENCH_KERNEL_TOLERANCE 15      // The rise in percent allowed by default for the time of a kernel
+#define BENCH_THROUGHPUT_TOLERANCE 10  // The drop in percent allowed by default for a throughput
+#define BENCH_LATENCY_TOLERANCE 20     // The rise in percent allowed by default for a percentile, doubled for p99
+#define MAX_BENCH_METRICS 64
+#define BENCH_NAME_LENGTH 32
+#define BENCH_HEADER "sudokuPuzzles bench size %d variant %d seed %d threads %d %d %d"  // First line of a results file
+#define INACTIVE_VALUE 0xFF     // parseCells() gives this for an inactive cell
+
+#define CONSUMER_BATCH 64        // A consumer moves its cursor on after this many puzzles
+#define SHARED_RING_MAGIC 0x53554452U
+
+#define COUNT_UNITS 1024           // A count is split into at least this many units before it is searched
+#define COUNT_SLICE_NODES 1000000  // The nodes a counting thread searches before handing back what is left
+
+#define CACHE_LINE 64             // Fields written by different threads are kept this far apart
+#define PIPELINE_ITEMS 128        // The number of puzzles that can be in a pipeline at once
+#define PIPELINE_QUEUE_SIZE 16    // The capacity of the queue between two stages, a power of 2
+#define PIPELINE_STAGES 4
+#define REORDER_WINDOW PIPELINE_ITEMS  // The slots of the ring feeding the writer, at least PIPELINE_ITEMS
+
+/* Hardware event counts of each phase of a pipeline, from perf_event_open() (Linux only) */
+#define PERF_COUNTERS FALSE             // TRUE to count the events of each phase, see perfBegin()
+#define PERF_LOG "perfCounters.csv"     // Where a pipeline writes the counts of each puzzle
+#define PERF_DEPTH 8                    // The most phases begun inside one another
+
+#define PHASE_OTHER 0   // Outside any phase
+#define PHASE_GRID 1    // The phases follow the order of the pipeline stages
+#define PHASE_DIG 2     // Hole digging, apart from its uniqueness checks
+#define PHASE_GRADE 3
+#define PHASE_WRITE 4   // Duplicate removal and output
+#define PHASE_UNIQUE 5  // countSolutions(), e.g. the uniqueness checks of the dig
+#define PHASES 6
+#define PERF_EVENTS 6
+
+#if PERF_COUNTERS && !defined(__linux__)
+#undef PERF_COUNTERS
+#define PERF_COUNTERS FALSE  // perf_event_open() is only on Linux
+#endif
+#if PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#define PERF_BEGIN(phase) perfBegin(phase)
+#define PERF_END(into) perfEnd(into)
+#else
+#define PERF_BEGIN(phase) ((void)0)
+#define PERF_END(into) ((void)0)
+#endif
+
+/* Spans of time spent in each part of the work by each thread, exported as a Chrome trace (chrome://tracing) */
+#define TRACE_SPANS FALSE              // TRUE to record spans, see traceBegin()
+#define TRACE_FILE "trace.json"        // Where the spans are written when the program exits
+#define TRACE_BUFFER_SPANS (1 << 18)   // The spans each thread keeps, later ones are dropped
+#define TRACE_DEPTH 16                 // The most spans open inside one another
+#define MAX_TRACE_THREADS 256
+
+#if TRACE_SPANS
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TRACE_CLOCK() ((long long)__rdtsc())
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_CLOCK() ((long long)__rdtsc())    // A few nanoseconds, converted to time by traceExport()
+#else
+#define TRACE_CLOCK() ((long long)(secondsNow() * 1e9))
+#endif
+#define TRACE_BEGIN(name) traceBegin(name)
+#define TRACE_END() traceEnd()
+#define TRACE_THREAD(name) traceThread(name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
+
+/* Histograms of the shape of the search tree of solverCount(), written as JSON when the program exits */
+#define SEARCH_PROFILE FALSE                      // TRUE to count the nodes of every search, see searchProfile()
+#define SEARCH_PROFILE_FILE "searchProfile.json"
+#define MAX_PROFILE_THREADS 256
+
+#if SEARCH_PROFILE
+#define PROFILE(statement) statement
+#else
+#define PROFILE(statement)
+#endif
+
+const char* phaseNames[PHASES] = { "other", "grid", "dig", "grade", "write", "unique" };
+const char* perfEventNames[PERF_EVENTS] = { "task-clock-ns", "cycles", "instructions", "branch-misses", "l1d-misses", "llc-misses" };
+
+/* Puzzle variants, each one is a different set of all-different regions on the board */
+#define CLASSIC 0   // Rows, columns and sub-squares
+#define X_SUDOKU 1  // Classic regions plus the two main diagonals
+#define WINDOKU 2   // Classic regions plus the extra "window" sub-squares offset one cell from each edge
+#define JIGSAW 3    // Rows, columns and irregular regions (jigsawLayout) in place of the sub-squares
+#define KILLER 4    // Classic regions plus cages built on the solution board (see generateKillerPuzzle)
+#define SAMURAI 5   // Five grids, the centre grid sharing a corner sub-square with each of the other four
+
+#define VARIANT CLASSIC  // The variant of puzzle generated by the program
+
+/* The length of a sub-square, the square root of SIZE */
+#if SIZE == 4
+#define SQUARE_SIZE 2
+#elif SIZE == 9
+#define SQUARE_SIZE 3
+#elif SIZE == 16
+#define SQUARE_SIZE 4
+#else
+#define SQUARE_SIZE 5
+#endif
+
+/* The board is a square of GRID_WIDTH x GRID_WIDTH cells. It holds exactly one grid except for SAMURAI, where
+ * it is wide enough for the outer grids to sit in its corners; the cells outside every grid are inactive.
+ * When using SAMURAI, raise MAX_EMPTY to allow the puzzle to use the whole board (e.g. 369 for SIZE 9)
+ */
+#if VARIANT == SAMURAI
+#define GRID_WIDTH (3*SIZE - 2*SQUARE_SIZE)
+#else
+#define GRID_WIDTH SIZE
+#endif
+
+#define GRID_CELLS (GRID_WIDTH*GRID_WIDTH)   // Total number of cells on the board
+#define MAX_CELL_REGIONS 6       // Most regions one cell can belong to: row, column, square, window and 2 diagonals
+#define MAX_REGIONS (15*SIZE)    // Upper bound on the regions of any variant, reached by the rows, columns and squares of SAMURAI
+#define MAX_CAGE_SIZE 5          // The largest cage of a Killer puzzle
+#define MAX_PEERS (MAX_CELL_REGIONS*(SIZE - 1) + MAX_CAGE_SIZE - 1)  // Upper bound on the cells sharing a region or cage with one cell
+
+#define MAX_SYMMETRIES 8         // The rotations and reflections of a square board
+
+#define NO_CAGE (-1)            // cageOf[] value for a cell outside of any cage
+#define MAX_SUM (SIZE*(SIZE + 1)/2)  // The largest sum any set of different integers can reach
+
+/* The number of sets of at most MAX_CAGE_SIZE different integers, C(SIZE,0) + C(SIZE,1) + ... + C(SIZE,5) */
+#define MAX_COMBOS (1 + SIZE + SIZE*(SIZE - 1)/2 + SIZE*(SIZE - 1)*(SIZE - 2)/6 \
+                    + SIZE*(SIZE - 1)*(SIZE - 2)*(SIZE - 3)/24 + SIZE*(SIZE - 1)*(SIZE - 2)*(SIZE - 3)*(SIZE - 4)/120)
+
+/* Stop value for countSolutions() to count every solution of a board */
+#define NO_LIMIT 0
+
+/* A set of Sudoku integers stored as bits, bit n is set when the integer n is in the set.
+ * Bit 0 belongs to the EMPTY value and is never a legal option.
+ */
+typedef unsigned int DigitMask;
+#define ALL_DIGITS ((((DigitMask)1) << (SIZE + 1)) - 2)
+
+/* The compiled rules of a puzzle variant. Every region lists the SIZE cells that must all hold different
+ * integers, and every cell lists its peers (the other cells sharing at least one region with it) so the
+ * solver never has to know which shapes the regions have.  Cells are numbered 0 - GRID_CELLS - 1 row by row,
+ * and only the active cells (those belonging to at least one region) take part in a puzzle.
+ */
+typedef struct {
+	int variant;                                         // One of CLASSIC, X_SUDOKU, WINDOKU, JIGSAW, KILLER, SAMURAI
+	int cellCount;                                       // The number of active cells
+	int active[GRID_CELLS];                              // TRUE for the cells that belong to the puzzle
+	int regionCount;                                     // The number of all-different regions
+	int regionCells[MAX_REGIONS][SIZE];                  // The cell numbers in each region
+	int cellRegionCount[GRID_CELLS];                     // The number of regions each cell belongs to
+	int cellRegions[GRID_CELLS][MAX_CELL_REGIONS];       // The regions each cell belongs to
+	int peerCount[GRID_CELLS];                           // The number of peers of each cell
+	int peers[GRID_CELLS][MAX_PEERS];                    // The cell numbers of the peers of each cell
+
+	int cageCount;                                       // The number of Killer cages, 0 for other variants
+	int cageOf[GRID_CELLS];                              // The cage each cell belongs to, or NO_CAGE
+	int cageSum[GRID_CELLS];                             // The sum of the integers in each cage
+	int cageSize[GRID_CELLS];                            // The number of cells in each cage
+	int cageCells[GRID_CELLS][MAX_CAGE_SIZE];            // The cell numbers in each cage
+
+	int symmetryCount;                                   // The rotations and reflections that keep the rules
+	int symmetries[MAX_SYMMETRIES][GRID_CELLS];          // The cell each cell moves to under each of them
+	int symmetryKinds[MAX_SYMMETRIES];                   // Which one each is, numbered as in buildSymmetries()
+} PuzzleRules;
+
+/* The sum-combination tables of Killer cages. Every set of different integers of up to MAX_CAGE_SIZE members
+ * is stored as a DigitMask in comboMasks[], grouped by (number of integers, sum) so that the sets able to
+ * complete a cage are the slice comboMasks[comboStart[count][sum]] ... comboMasks[comboStart[count][sum + 1] - 1]
+ */
+typedef struct {
+	int comboStart[MAX_CAGE_SIZE + 1][MAX_SUM + 2];      // Start of the slice of each (count, sum)
+	DigitMask comboMasks[MAX_COMBOS];                    // Every set of integers, ordered by count then sum
+} CageTables;
+
+/* The irregular regions of a JIGSAW puzzle, one letter per cell with each letter naming a region.
+ * Only a 9x9 layout is provided, other sizes must supply their own layout here.
+ */
+#if SIZE == 9
+const char* jigsawLayout =
+	"AAAABBCCC"
+	"AAABBECCF"
+	"DAABEECCF"
+	"DDBBEECCF"
+	"DDBGEEEEF"
+	"DDBGFFFFF"
+	"DDGGGHIII"
+	"GGGGHHHII"
+	"HHHHHIIII";
+#else
+const char* jigsawLayout = NULL;
+#endif
+
+// The rules used by every solving and generating function, each thread compiles its own with buildRules()
+THREAD_LOCAL PuzzleRules rules;
+
+// The Killer sum-combination tables, filled by buildCageTables()
+THREAD_LOCAL CageTables cageTables;
+
+#define MAX_UNAVOIDABLE 256  // The most unavoidable sets kept for one solution board
+
+/* The work done once on a solution board and shared by every puzzle made from it.
+ * An unavoidable set is a group of cells whose integers can be rearranged into another valid board, so a
+ * puzzle with none of its cells as clues can't have a unique solution. Here the sets are the "deadly
+ * rectangles": two rows and two columns whose four corners hold a pair of integers a b / b a.
+ */
+typedef struct {
+	int grid[GRID_WIDTH][GRID_WIDTH];         // The solution board
+	int setCount;                             // The number of unavoidable sets found
+	int setCells[MAX_UNAVOIDABLE][4];         // The cells of each unavoidable set
+} GridAnalysis;
+
+/* One level of the solver's search: the cell being branched on and the integers still to try in it */
+typedef struct {
+	int cell;
+	DigitMask untried;   // The integers of the cell's moves that haven't been tried yet
+	int placed;          // TRUE while the cell holds the integer of the move being searched
+} SolverFrame;
+
+/* The working memory of a solver, all of it carved from one block supplied by the caller (see solverInit()).
+ * A search needs no memory beyond the context, so a thread can keep one context and reuse it for every
+ * board without touching the heap, and sizes decided at run time only change how big the block must be.
+ */
+typedef struct {
+	int stackSize;             // The deepest search the stack has room for, one level per empty cell
+	SolverFrame* stack;        // The explicit stack replacing recursion in solverCount()
+	DigitMask* candidates;     // The legal integers of every empty cell, rebuilt at each level
+	long long nodeLimit;       // The moves solverCount() may make before pausing, 0 for no limit
+	int depth;                 // The levels left on the stack by a paused search, 0 once a search is complete
+} SolverContext;
+
+#define ARENA_ALIGN 16  // Every part of a solver workspace starts on this boundary
+#define ARENA_ROUND(bytes) (((bytes) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+// The workspace of the largest solver context, enough for the search of any board of this build
+#define SOLVER_WORKSPACE_MAX (ARENA_ROUND(sizeof(SolverContext)) + ARENA_ROUND((GRID_CELLS + 1) * sizeof(SolverFrame)) \
+                              + ARENA_ROUND(GRID_CELLS * sizeof(DigitMask)))
+
+// The solver context used by countSolutions() in each thread, set up on first use from its own workspace
+THREAD_LOCAL alignas(ARENA_ALIGN) unsigned char threadSolverWorkspace[SOLVER_WORKSPACE_MAX];
+THREAD_LOCAL SolverContext* threadSolver = NULL;
+
+// Global backtrack counter for tracking solution branches, wide enough for a count that runs for days
+THREAD_LOCAL unsigned long long backtrackCount = 0;
+
+// The state of the pseudo-random number generator of each thread, see seedRandom() and randomInt()
+THREAD_LOCAL unsigned long long randomState = 0;
+
+/* The number of cells randomFillBoard() may still try before giving up on its current attempt.
+ * A random fill occasionally wanders into a huge dead-end subtree (more often on irregular JIGSAW regions),
+ * and starting over with new random choices is much cheaper than searching it to the end.
+ */
+#define FILL_RESTART_NODES (20*GRID_CELLS)
+THREAD_LOCAL int fillBudget = 0;
+
+/* What making puzzles has cost a thread since the counts were last cleared, see runTelemetry().
+ * A check is one search made by a generator to test a removal or a set of clues (uniquenessCheck()).
+ */
+typedef struct {
+	long long fillNodes;                 // Cells tried by randomFillBoard(), in every attempt
+	int fillRestarts;                    // Attempts that ran out of fillBudget
+	int checks;
+	long long checkNodes;                // Search nodes of all the checks
+	int accepted;                        // Cells emptied for good
+	int rejected;                        // Cells that had to keep their clue
+	int emptyChecks[GRID_CELLS + 1];     // Checks by the number of empty cells of the board checked
+	long long emptyNodes[GRID_CELLS + 1];  // and their search nodes
+} GenerationStats;
+
+THREAD_LOCAL GenerationStats generationStats;
+
+/* One bucket of an order: a number of puzzles wanted with a difficulty grade and a range of clues.
+ * The scheduler keeps the yield (accepted / attempts) and the time spent on the attempts aimed at each bucket.
+ */
+typedef struct {
+	int grade;          // EASY, MEDIUM or HARD
+	int minClues;       // The fewest clues allowed
+	int maxClues;       // The most clues allowed
+	int wanted;         // The number of puzzles ordered
+	int filled;         // The number of puzzles delivered so far
+	int inFlight;       // The number of attempts currently aimed at this bucket
+	int attempts;       // The number of finished attempts aimed at this bucket
+	int hits;           // The attempts aimed at this bucket that it accepted
+	double seconds;     // The time spent on the attempts aimed at this bucket
+} OrderBucket;
+
+/* An order of puzzles shared by the worker threads of runOrder(), every field is guarded by lock */
+typedef struct {
+	mtx_t lock;
+	int bucketCount;
+	OrderBucket buckets[MAX_BUCKETS];
+	int produced;        // Puzzles made, whether or not a bucket wanted them
+	int discarded;       // Puzzles that no unfilled bucket wanted
+	unsigned long long seed;  // The seed of the order, each attempt derives its own from it
+	unsigned long long nextAttempt;  // The number of the next attempt, which selects its random numbers
+	FILE* output;        // Where accepted puzzles are written, stdout or the log
+	char checkpointPath[MAX_PATH_LENGTH];  // The checkpoint of the log, empty without a log
+	double lastCheckpoint;  // When the checkpoint was last saved
+} GenerationOrder;
+
+/* A bounded multi-producer multi-consumer queue of pointers without locks.
+ * Each slot carries a sequence number telling whether it is ready to be written (sequence == position)
+ * or read (sequence == position + 1) at a given position, so producers and consumers only ever contend on
+ * their own position counter. A full queue makes producers wait, which holds back the stages feeding it.
+ */
+typedef struct {
+	atomic_size_t sequence;
+	void* item;
+} QueueSlot;
+
+typedef struct {
+	alignas(CACHE_LINE) atomic_size_t writePosition;  // The next position to write
+	alignas(CACHE_LINE) atomic_size_t readPosition;   // The next position to read
+	alignas(CACHE_LINE) atomic_int closed;             // Set once no more items will be written
+	size_t mask;                                        // The capacity - 1
+	QueueSlot* slots;
+} BoundedQueue;
+
+/* The ring carrying finished puzzles from many producers to the single writer of a pipeline.
+ * The puzzle with index i goes into slot i % REORDER_WINDOW, so the ring doubles as the reorder window: the
+ * writer waits on the slot of the next index it needs and takes the puzzles in index order whatever order
+ * they finish in. Producers never contend, each index has one slot, and a slot's sequence number says whether
+ * it is free for index i (sequence == i) or holds it (sequence == i + 1).
+ */
+typedef struct {
+	alignas(CACHE_LINE) atomic_size_t sequence;
+	void* item;
+} ReorderSlot;
+
+typedef struct {
+	ReorderSlot slots[REORDER_WINDOW];
+	alignas(CACHE_LINE) size_t nextIndex;  // The next index the writer needs, only touched by the writer
+} ReorderRing;
+
+#if PERF_COUNTERS
+/* The event counters of a thread and what they have counted in each phase, see perfBegin() */
+typedef struct {
+	int leader;                                        // The group of counters, -1 if it couldn't be opened
+	int files[PERF_EVENTS];                            // Each counter, -1 if the event can't be counted here
+	int slots[PERF_EVENTS];                            // Where each counter is in a read of the group
+	long long last[PERF_EVENTS];                       // The counts at the last change of phase
+	int phases[PERF_DEPTH];                            // The phases begun and not yet ended, innermost last
+	int depth;
+	long long counts[PHASES][PERF_EVENTS];             // Counted in each phase so far
+	long long begun[PERF_DEPTH][PHASES][PERF_EVENTS];  // counts when each phase of phases began
+} PerfCounters;
+
+/* The counts of every thread of a run put together */
+typedef struct {
+	mtx_t lock;
+	long long counts[PHASES][PERF_EVENTS];
+	int counted[PERF_EVENTS];                          // The threads that could count each event
+} PerfTotals;
+
+THREAD_LOCAL PerfCounters threadPerf;
+#endif
+
+#if TRACE_SPANS
+/* A span of time of one thread, in TRACE_CLOCK() ticks */
+typedef struct {
+	const char* name;
+	long long start;
+	long long end;                             // 0 while the span is open
+} TraceSpan;
+
+/* The spans recorded by one thread, only ever written by it */
+typedef struct {
+	int thread;                                // Numbered in the order the threads first record a span
+	const char* name;                          // What the thread does, or NULL
+	int count;
+	int depth;                                 // The spans open
+	int open[TRACE_DEPTH];                     // Which they are, innermost last, -1 for a dropped span
+	long long dropped;
+	TraceSpan spans[TRACE_BUFFER_SPANS];
+} TraceBuffer;
+
+THREAD_LOCAL TraceBuffer* threadTrace;
+TraceBuffer* traceBuffers[MAX_TRACE_THREADS];  // Every thread's spans, for traceExport()
+atomic_int traceThreads;
+long long traceStartTicks;                      // The clock when the program started, to convert ticks to time
+double traceStartSeconds;
+#endif
+
+#if SEARCH_PROFILE
+/* What the searches of one thread did. A node is a move: an integer placed in a cell, at the depth of the
+ * number of moves on the path to it including itself.
+ */
+typedef struct {
+	long long searches;
+	long long nodes;
+	long long depthNodes[GRID_CELLS + 1];      // Nodes by depth
+	long long cellNodes[GRID_CELLS];           // Nodes by the cell the integer was placed in
+	long long branching[SIZE + 1];             // Levels of the search by the number of moves to try, 1 is forced
+	long long deadEnds[GRID_CELLS + 1];        // Nodes after which chooseBranch() found no move, by depth
+	long long solutions[GRID_CELLS + 1];       // Nodes that completed the board, by depth
+} SearchProfile;
+
+THREAD_LOCAL SearchProfile* threadProfile;
+THREAD_LOCAL SearchProfile unlistedProfile;           // For a thread past MAX_PROFILE_THREADS, not exported
+SearchProfile* searchProfiles[MAX_PROFILE_THREADS];  // Every thread's histograms, for searchProfileExport()
+atomic_int profileThreads;
+#endif
+
+/* A kernel and its benchmark, which does a number of operations and returns a value depending on all of them */
+typedef struct {
+	const char* name;
+	const char* operation;  // What one operation is
+	long long (*run)(long long operations);
+} BenchKernel;
+
+/* A result of the benchmarks, see benchRecord() */
+typedef struct {
+	char name[BENCH_NAME_LENGTH];
+	double value;
+	int higherIsBetter;  // TRUE for a throughput, FALSE for a time
+	double tolerance;    // The change in percent a saved baseline allows
+} BenchMetric;
+
+/* A puzzle travelling through the pipeline */
+typedef struct {
+	int index;                                 // The order in which the grid was started
+	unsigned long long random;                 // The random number state of this puzzle, carried between stages
+	int solution[GRID_WIDTH][GRID_WIDTH];      // The solution board
+	int puzzle[GRID_WIDTH][GRID_WIDTH];        // The puzzle dug from it
+	int clues;
+	int grade;
+#if PERF_COUNTERS
+	long long perf[PHASES][PERF_EVENTS];       // The events counted while the stages worked on this puzzle
+#endif
+} PipelineItem;
+
+/* A puzzle in a shared memory ring. It is read in place by the consumers, the cells hold the integers with
+ * EMPTY for an empty (or inactive) cell.
+ */
+typedef struct {
+	atomic_llong sequence;                     // 1 + the number of the puzzle in the ring once it is written
+	int index;                                 // The index of the puzzle in its run, as in pipeline output
+	int grade;
+	int clues;
+	unsigned char cells[GRID_CELLS];
+} SharedPuzzle;
+
+/* Where a consumer of a shared memory ring has got to, on a cache line of its own */
+typedef struct {
+	alignas(CACHE_LINE) atomic_llong next;    // The number of the next puzzle the consumer will read
+	atomic_int finished;                      // Set once the consumer has read the whole run
+} ConsumerCursor;
+
+/* A ring of puzzles in POSIX shared memory, written by one publishing process and read by every consumer.
+ * The publisher never overwrites a puzzle before every consumer has moved past it, so no puzzle is lost.
+ */
+typedef struct SharedRing {
+	unsigned int magic;                        // SHARED_RING_MAGIC, with size and variant to check the build
+	int size;
+	int variant;
+	int slotCount;                             // A power of 2
+	int consumers;                             // Cursors in use, the publisher waits for each of them
+	alignas(CACHE_LINE) atomic_llong published;  // The puzzles written so far
+	atomic_llong total;                        // The puzzles of the whole run once the publisher is done, else -1
+	atomic_int finishedConsumers;              // Consumers done with the run, the last of them removes the ring
+	ConsumerCursor cursors[MAX_CONSUMERS];
+	SharedPuzzle slots[];
+} SharedRing;
+
+/* A puzzle in the data file of a store, every record the same size so that it is found from its number */
+typedef struct {
+	unsigned char grade;
+	unsigned char symmetry;
+	unsigned short clues;
+	char board[GRID_CELLS + 1];                // As text, see formatBoard()
+} StoredPuzzle;
+
+/* The start of both the data and the index file of a store, checked against the build */
+typedef struct {
+	unsigned int magic;                        // STORE_MAGIC
+	int size;
+	int variant;
+	int recordSize;
+} StoreHeader;
+
+/* The index file of a store: for each bucket (see storeBucket()) the numbers of its puzzles, in a random order
+ * fixed when they were added. Followed by starts[STORE_BUCKETS + 1], bucket b being the entries starts[b] ...
+ * starts[b + 1] - 1, and then the entries.
+ */
+typedef struct {
+	StoreHeader header;
+	unsigned int records;                      // The puzzles of the data file it indexes
+	unsigned int bucketCount;                  // STORE_BUCKETS
+} StoreIndex;
+
+/* A file of boards mapped into memory and solved by threads a chunk at a time, see runSolveFile() */
+typedef struct {
+	const char* text;                          // The mapped file
+	size_t length;
+	int chunkCount;
+	int parseOnly;                             // TRUE to check the boards without solving them
+	alignas(CACHE_LINE) atomic_int nextChunk;  // The next chunk to be taken by a thread
+	atomic_llong boards;
+	atomic_llong errors;
+	mtx_t lock;                                // Guards the fields below
+	char** answers;                            // The answers of each chunk once it is done, NULL before
+	size_t* answerLengths;
+	int nextAnswer;                            // The first chunk whose answers are not yet written
+} BoardFile;
+
+struct Pipeline;
+
+/* One stage of the pipeline: a group of threads taking items from input, processing them and passing them to
+ * output. process() returns FALSE to drop an item, which then goes straight back to the free items.
+ */
+typedef struct {
+	struct Pipeline* pipeline;
+	const char* name;
+	int threads;
+	int (*process)(struct Pipeline* pipeline, PipelineItem* item);
+	BoundedQueue* input;
+	BoundedQueue* output;                          // NULL for the stage feeding the writer's ring
+	alignas(CACHE_LINE) atomic_int running;        // Threads of the stage still working
+	atomic_int items;                              // Items processed
+	atomic_llong busyNanoseconds;                  // Time spent processing
+	atomic_llong waitNanoseconds;                  // Time spent waiting on an empty input or a full output
+} PipelineStage;
+
+/* A generation pipeline: the free items feed the grid stage and the writer hands them back */
+typedef struct Pipeline {
+	PipelineStage stages[PIPELINE_STAGES];
+	BoundedQueue queues[PIPELINE_STAGES - 1];     // queues[0] holds the free items, queues[s] feeds stage s
+	ReorderRing ring;                              // Feeds the writer, the last stage
+	PipelineItem items[PIPELINE_ITEMS];
+	int count;                                     // The number of grids to make
+	alignas(CACHE_LINE) atomic_int nextIndex;      // The index of the next grid
+	unsigned long long seed;                       // Each puzzle's random numbers are derived from it and its index
+	int shardId;                                   // This pipeline makes the puzzles numbered shardId + k * shardCount
+	int shardCount;
+	FILE* output;                                  // Where the writer writes the puzzles
+	SharedRing* shared;                            // Or the shared memory ring it publishes them to
+	int quiet;                                     // TRUE to leave out the report of each stage
+	unsigned long long* seen;                      // Hashes of the puzzles written so far (writer only)
+	int seenSize;                                  // The capacity of seen, a power of 2
+	int duplicates;
+	int written;
+#if PERF_COUNTERS
+	PerfTotals perf;
+	FILE* perfLog;                                 // The counts of each puzzle, see PERF_LOG
+#endif
+} Pipeline;
+
+/* A unit of work handed out by a coordinator: the puzzles firstIndex ... lastIndex of the run */
+typedef struct {
+	int firstIndex;
+	int lastIndex;
+	int finished;          // TRUE once a worker has reported every puzzle of the unit
+	int holders;           // The number of workers currently making the unit
+	double assignedAt;     // When the unit was last handed out
+} WorkUnit;
+
+/* A worker process connected to a coordinator */
+typedef struct {
+	int socket;                       // -1 for a free slot
+	int unit;                         // The unit the worker is making, -1 if none
+	int unitsFinished;
+	int length;                       // The bytes waiting in buffer for the end of their line
+	char buffer[GRID_CELLS + 128];
+} WorkerConnection;
+
+/* A solution kept by a SolutionCache, for a board in canonical form (see canonicalForm()) */
+typedef struct {
+	unsigned long long hash;          // The hash of key
+	char key[GRID_CELLS + 1];         // The canonical board
+	char solution[GRID_CELLS + 1];    // Its solution in the same form
+	int solutions;                    // 0, 1, or 2 for more than one
+	int newer;                        // The entries used just after and just before this one, -1 at the ends
+	int older;
+	int chain;                        // The next entry in the same bucket of the hash table, -1 at the end
+} CacheEntry;
+
+/* One part of a SolutionCache, with its own lock, hash table and least recently used order */
+typedef struct {
+	mtx_t lock;
+	int capacity;
+	int count;
+	int newest;                       // The most and least recently used entries, -1 when empty
+	int oldest;
+	int bucketCount;                  // A power of 2
+	int* buckets;                     // The first entry of each bucket, -1 for none
+	CacheEntry* entries;
+	long long hits;
+	long long misses;
+} CacheShard;
+
+/* Solutions of recently solved boards, shared by threads. A board is looked up by its canonical form, so the
+ * same puzzle relabeled, rotated or reflected finds the solution of the first one solved.
+ */
+typedef struct {
+	CacheShard shards[CACHE_SHARDS];
+} SolutionCache;
+
+/* A client connected to the solve service */
+typedef struct {
+	int socket;                       // -1 for a free slot
+	unsigned int generation;          // Counts the connections of the slot, so one isn't sent the answers of another
+	int reading;                      // FALSE once the client has sent everything, it stays open for its answers
+	int pending;                      // Its requests in the batch, still to be answered
+	int length;                       // The bytes waiting in buffer for the end of their line
+	char buffer[GRID_CELLS + 128];
+	char* output;                     // Answers the socket hasn't taken yet
+	int outputLength;
+	int outputSize;
+} ClientConnection;
+
+/* One request to the solve service and its answer */
+typedef struct {
+	int client;                       // The connection the answer goes back to
+	unsigned int generation;          // The generation of that connection when the request was made
+	char board[GRID_CELLS + 1];
+	int sameAs;                       // The earlier request of the batch with the same board, or -1
+	int solutions;                    // 0, 1, or 2 for more than one, -1 for a board that can't be read
+	char solution[GRID_CELLS + 1];
+} SolveRequest;
+
+/* Solver threads working through batches of requests together. Every field after lock is guarded by it */
+typedef struct {
+	mtx_t lock;
+	cnd_t started;                    // Signalled when a batch is handed over
+	cnd_t finished;                   // Signalled when the last thread is done with a batch
+	SolveRequest* requests;           // The batch being solved
+	int requestCount;
+	atomic_int nextRequest;           // The next request of the batch to be taken by a thread
+	int batch;                        // Counts the batches, a thread waits for the next one
+	int working;                      // Threads still solving the current batch
+	int threads;
+	int stopping;
+	SolutionCache* cache;             // Solutions kept from earlier requests, NULL for none
+} BatchSolver;
+
+/* A puzzle read back from a shard archive by runMerge() */
+typedef struct {
+	int index;
+	int grade;
+	int clues;
+	char board[GRID_CELLS + 1];
+} ArchiveRecord;
+
+/* An exact count of the solutions of a board, split into subproblems that any number of threads (or machines)
+ * can work through. Every subproblem is the board with some more cells filled in, and the subproblems still
+ * pending plus the solutions counted so far always make up the whole count, so saving them is a checkpoint.
+ * Every field after lock is guarded by it.
+ */
+typedef struct {
+	mtx_t lock;
+	cnd_t changed;                     // Signalled when a search ends, with new subproblems or none left to wait for
+	char board[GRID_CELLS + 1];        // The board being counted, as text
+	int firstUnit;                     // The range of units of the board this count covers
+	int lastUnit;
+	char (*pending)[GRID_CELLS + 1];   // The subproblems not yet searched, taken from the end
+	int pendingCount;
+	int pendingSize;                   // The capacity of pending
+	char (*searching)[GRID_CELLS + 1]; // The subproblem each thread is working on, empty when idle
+	int busy;                          // The number of threads working on a subproblem
+	int nextThread;
+	unsigned long long solutions;      // The solutions of the subproblems finished so far
+	unsigned long long nodes;          // The search nodes spent on them
+	char checkpointPath[MAX_PATH_LENGTH];  // Where the count is saved, empty to never save it
+	double lastCheckpoint;
+	int failed;                        // Set if the pending list couldn't grow
+} SolutionCount;
+
+/* Function prototypes */
+
+/* Puzzle rules */
+int buildRules(int variant);
+void addGrid(int yOffset, int xOffset, int squares);
+void addRegion(int cells[SIZE]);
+void buildSymmetries(void);
+void compilePeers(void);
+void buildCageTables(void);
+int buildCages(int board[][GRID_WIDTH]);
+
+/* Puzzle Generation */
+int generateBoard(int board[][GRID_WIDTH]);
+int randomFillBoard(int board[][GRID_WIDTH]);
+int generatePuzzle(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty);
+int generatePuzzleBuildUp(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int prune, int maxEmpty);
+int generateWithStrategy(int strategy, int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty);
+int digCells(int board[][GRID_WIDTH], int listOfCells[], int listSize, int maxRemovals);
+int generatePuzzleBatched(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty);
+int digCellsBatched(int board[][GRID_WIDTH], int listOfCells[], int listSize, int maxRemovals);
+int digBlock(int board[][GRID_WIDTH], int block[], int blockSize, int knownToFail, int* allRemoved);
+void analyzeGrid(int grid[][GRID_WIDTH], GridAnalysis* analysis);
+int generatePuzzleFromGrid(GridAnalysis* analysis, int board[][GRID_WIDTH]);
+int removalKeepsUnique(int board[][GRID_WIDTH], int xPos, int yPos, int value);
+int boardIsValid(int board[][GRID_WIDTH]);
+int generateKillerPuzzle(int board[][GRID_WIDTH], int solution[][GRID_WIDTH]);
+int uniquenessCheck(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit);
+
+/* The cost of generation, puzzle by puzzle */
+int runTelemetry(int argc, char* argv[]);
+int compareLongs(const void* a, const void* b);
+void printDistribution(const char* name, long long* values, int count);
+
+/* Microbenchmarks of the solver kernels */
+int runBench(int argc, char* argv[]);
+int benchChosen(const char* name, int named, char* names[]);
+void benchRecord(const char* name, double value, int higherIsBetter, double tolerance);
+void benchKernel(const BenchKernel* kernel);
+void benchGeneration(void);
+void benchPipeline(void);
+int benchCompare(const char* path, int allRun);
+void benchSetup(void);
+long long benchCandidateMask(long long operations);
+long long benchPermittedValue(long long operations);
+long long benchNextEmpty(long long operations);
+long long benchChooseBranch(long long operations);
+long long benchRandomInt(long long operations);
+long long benchShuffle(long long operations);
+long long benchDuplicateBoard(long long operations);
+long long benchFormatBoard(long long operations);
+long long benchParseBoard(long long operations);
+int compareDoubles(const void* a, const void* b);
+
+/* Functions manipulating Sudoku boards */
+void duplicateBoard(int read[][GRID_WIDTH], int write[][GRID_WIDTH]);
+void printBoard(int board[][GRID_WIDTH]);
+void printCages(void);
+int solveBoard(int board[][GRID_WIDTH], int solution[][GRID_WIDTH]);
+int countSolutions(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit);
+
+/* Solver contexts working in caller-provided memory */
+size_t solverWorkspaceSize(int emptyCells);
+SolverContext* solverInit(void* workspace, size_t workspaceSize, int emptyCells);
+int solverCount(SolverContext* solver, int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit);
+
+/* Funtions operating on Sudoku cell values */
+int nextEmpty(int board[][GRID_WIDTH], int* add_xVal, int* add_yVal);
+int chooseBranch(int board[][GRID_WIDTH], DigitMask candidates[GRID_CELLS], int* branchCell, DigitMask* branchValues);
+int getValidIntegers(int board[][GRID_WIDTH], int xPos, int yPos, int validIntegers[SIZE]);
+void permittedValue(int board[][GRID_WIDTH], int xPos, int yPos, int permitted[SIZE+1]);
+DigitMask candidateMask(int board[][GRID_WIDTH], int xPos, int yPos);
+DigitMask cageCandidates(int board[][GRID_WIDTH], int cage);
+int countDigits(DigitMask digits);
+
+/* A list shuffling function */
+void shuffleValues(int list[SIZE], int listSize);
+
+/* Random numbers */
+void seedRandom(unsigned long long seed);
+unsigned long long streamSeed(unsigned long long seed, unsigned long long stream);
+int randomInt(int range);
+
+/* Grading and text output */
+int gradePuzzle(int board[][GRID_WIDTH]);
+void formatBoard(int board[][GRID_WIDTH], char text[GRID_CELLS + 1]);
+int parseBoard(const char* text, int board[][GRID_WIDTH]);
+
+/* Exact counting of solutions that can be saved and resumed */
+int runCount(int argc, char* argv[]);
+int countWorker(void* arg);
+int splitIntoUnits(int board[][GRID_WIDTH], char (**units)[GRID_CELLS + 1]);
+int addPending(SolutionCount* count, const char text[GRID_CELLS + 1]);
+void spillPending(SolutionCount* count, SolverContext* solver, int board[][GRID_WIDTH]);
+int saveCount(SolutionCount* count);
+int loadCount(SolutionCount* count);
+
+/* Filling orders of puzzles with worker threads */
+int runOrder(int argc, char* argv[]);
+int orderWorker(void* arg);
+int pickBucket(GenerationOrder* order);
+int routePuzzle(GenerationOrder* order, int grade, int clues, int preferred);
+int openOrderLog(GenerationOrder* order, const char* logPath);
+int writeCheckpoint(GenerationOrder* order);
+int truncateFile(FILE* file, long size);
+double secondsNow(void);
+
+/* Pipelined generation */
+int runPipeline(int argc, char* argv[]);
+int executePipeline(Pipeline* pipeline, int gridThreads, int digThreads, int gradeThreads);
+int pipelineWorker(void* arg);
+int pipelineWriter(void* arg);
+int stageFillGrid(Pipeline* pipeline, PipelineItem* item);
+int stageDig(Pipeline* pipeline, PipelineItem* item);
+int stageGrade(Pipeline* pipeline, PipelineItem* item);
+int stageWrite(Pipeline* pipeline, PipelineItem* item);
+void queueInit(BoundedQueue* queue, size_t capacity);
+int queueTryPush(BoundedQueue* queue, void* item);
+int queueTryPop(BoundedQueue* queue, void** item);
+void reorderInit(ReorderRing* ring);
+int reorderTryPush(ReorderRing* ring, size_t index, void* item);
+int reorderTryPop(ReorderRing* ring, void** item);
+unsigned long long hashText(const char* text);
+
+/* Sharded generation and merging of shard archives */
+int runShard(int argc, char* argv[]);
+int runMerge(int argc, char* argv[]);
+int readArchive(const char* path, ArchiveRecord** records, int* recordCount, int* recordSize, int header[4],
+	unsigned long long* seed);
+int compareRecordBoards(const void* a, const void* b);
+int compareRecordIndexes(const void* a, const void* b);
+
+/* Coordinator and worker processes on one machine */
+int runCoordinator(int argc, char* argv[]);
+int runWorker(int argc, char* argv[]);
+int openListener(const char* path);
+
+/* A solve service answering many clients in batches */
+int runService(int argc, char* argv[]);
+int takeRequests(ClientConnection* client, int clientNumber, SolveRequest* batch, int* batchCount, int maxBatch);
+int queueAnswer(ClientConnection* client, const char* answer);
+int sendAnswers(ClientConnection* client);
+void solveBatch(BatchSolver* solver, SolveRequest* requests, int requestCount);
+int batchSolverThread(void* arg);
+
+/* Canonical forms and a cache of solutions */
+unsigned long long canonicalForm(int board[][GRID_WIDTH], char text[GRID_CELLS + 1], int* symmetry, int relabel[SIZE + 1]);
+void toCanonical(int board[][GRID_WIDTH], int symmetry, const int relabel[SIZE + 1], char text[GRID_CELLS + 1]);
+void fromCanonical(const char text[GRID_CELLS + 1], int symmetry, const int relabel[SIZE + 1], int board[][GRID_WIDTH]);
+int cacheInit(SolutionCache* cache, int entries);
+void cacheFree(SolutionCache* cache);
+int cacheLookup(SolutionCache* cache, unsigned long long hash, const char* key, int* solutions, char solution[GRID_CELLS + 1]);
+void cacheStore(SolutionCache* cache, unsigned long long hash, const char* key, int solutions, const char* solution);
+void cacheUnlink(CacheShard* shard, int entry);
+void cacheMakeNewest(CacheShard* shard, int entry);
+
+/* Handing puzzles to other processes through shared memory */
+int runPublish(int argc, char* argv[]);
+int runConsume(int argc, char* argv[]);
+SharedRing* openSharedRing(const char* name, int create);
+void sharedPublish(SharedRing* ring, int index, int grade, int clues, int board[][GRID_WIDTH]);
+void backOff(int* spins);
+
+/* A store of puzzles on disk, indexed for taking puzzles of a kind */
+int runStore(int argc, char* argv[]);
+int storeAdd(const char* directory, int fileCount, char* files[]);
+int storeTake(const char* directory, int argc, char* argv[]);
+int storeBucket(int grade, int clues, int symmetry);
+int symmetryClass(int board[][GRID_WIDTH]);
+void* mapFile(const char* path, size_t* bytes, int writable);
+
+#if PERF_COUNTERS
+/* Hardware event counters around each phase of the work */
+void perfOpen(void);
+void perfRead(long long values[PERF_EVENTS]);
+void perfSwitch(void);
+void perfBegin(int phase);
+void perfEnd(long long into[PHASES][PERF_EVENTS]);
+void perfClose(PerfTotals* totals);
+void perfReport(FILE* output, PerfTotals* totals);
+#endif
+
+#if TRACE_SPANS
+/* Chrome trace spans */
+TraceBuffer* traceBuffer(void);
+void traceBegin(const char* name);
+void traceEnd(void);
+void traceThread(const char* name);
+void traceExport(void);
+#endif
+
+#if SEARCH_PROFILE
+/* Histograms of the search tree */
+SearchProfile* searchProfile(void);
+void searchProfileExport(void);
+void writeHistogram(FILE* output, const char* name, const long long* counts, int length);
+#endif
+
+/* Solving files of boards */
+int runSolveFile(int argc, char* argv[]);
+int boardFileThread(void* arg);
+const char* chunkStart(const BoardFile* file, int chunk);
+int parseCells(const char* text, unsigned char values[GRID_CELLS]);
+
+int main(int argc, char* argv[]) {
+	// A test case provided for debugging solving methods
+	//int testCase[SIZE][SIZE] = {0,2,0,0,0,0,0,0,0,
+	//							0,0,0,6,0,0,0,0,3,
+	//							0,7,4,0,8,0,0,0,0,
+	//							0,0,0,0,0,3,0,0,2,
+	//							0,8,0,0,4,0,0,1,0,
+	//							6,0,0,5,0,0,0,0,0,
+	//							0,0,0,0,1,0,7,8,0,
+	//							5,0,0,0,0,9,0,0,0,
+	//							0,0,0,0,0,0,0,4,0};	
+
+	/* seed the random number generator with the current time */
+	seedRandom((unsigned long long)time(NULL));
+#if SEARCH_PROFILE
+	atexit(searchProfileExport);
+#endif
+#if TRACE_SPANS
+	traceStartTicks = TRACE_CLOCK();
+	traceStartSeconds = secondsNow();
+	atexit(traceExport);
+#endif
+
+	/* sudokuPuzzles order <threads> <bucket>... fills an order of puzzles instead of the interactive puzzle */
+	if (argc > 1 && strcmp(argv[1], "order") == 0) {
+		return runOrder(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles count <board> ... counts every solution of a board, see runCount() */
+	if (argc > 1 && strcmp(argv[1], "count") == 0) {
+		return runCount(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles shard <count> <seed> <shardId> <shardCount> <archive> makes one shard of a sharded run */
+	if (argc > 1 && strcmp(argv[1], "shard") == 0) {
+		return runShard(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles merge <output> <archive>... checks and combines the shard archives */
+	if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+		return runMerge(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles coordinate <socket> ... hands out units of a run to worker processes, see runCoordinator() */
+	if (argc > 1 && strcmp(argv[1], "coordinate") == 0) {
+		return runCoordinator(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles work <socket> ... makes the units a coordinator hands out */
+	if (argc > 1 && strcmp(argv[1], "work") == 0) {
+		return runWorker(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles serve <socket> ... answers solve requests, see runService() */
+	if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+		return runService(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles publish <name> <consumers> <count> ... hands puzzles to other processes, see runPublish() */
+	if (argc > 1 && strcmp(argv[1], "publish") == 0) {
+		return runPublish(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles consume <name> <consumer> reads the puzzles published to a ring */
+	if (argc > 1 && strcmp(argv[1], "consume") == 0) {
+		return runConsume(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles store <directory> add|take ... keeps puzzles on disk, see runStore() */
+	if (argc > 1 && strcmp(argv[1], "store") == 0) {
+		return runStore(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles solve <file> ... solves every board of a file, see runSolveFile() */
+	if (argc > 1 && strcmp(argv[1], "solve") == 0) {
+		return runSolveFile(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles telemetry <count> [seed] reports the cost of making each puzzle, see runTelemetry() */
+	if (argc > 1 && strcmp(argv[1], "telemetry") == 0) {
+		return runTelemetry(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles bench [kernel...] times the solver kernels, see runBench() */
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		return runBench(argc - 2, argv + 2);
+	}
+	/* sudokuPuzzles pipeline <count> ... makes count puzzles with a staged pipeline */
+	if (argc > 1 && strcmp(argv[1], "pipeline") == 0) {
+		return runPipeline(argc - 2, argv + 2);
+	}
+
+	/* Compile the regions of the chosen variant into the tables used by the solver */
+	if (!buildRules(VARIANT)) {
+		printf("Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	/* Create arrays to hold puzzle and solution */
+	int solution[GRID_WIDTH][GRID_WIDTH] = { 0 };   // A completed Sudoku problem
+	int puzzle[GRID_WIDTH][GRID_WIDTH] = { 0 };     // A Sudoku puzzle
+
+	/* user input functionality*/
+	char pressEnter = '\n';
+	
+
+	int emptyCells;
+
+	if (PUZZLES_PER_GRID > 1) {
+		/* Make several puzzles from one solution board, each with its own removal order. The analysis of the
+		 * board is done once and shared by all of them.
+		 */
+		static GridAnalysis analysis;
+		generateBoard(solution);
+		if (rules.variant == KILLER) {
+			buildCages(solution);
+			printCages();
+			printf("\n\n");
+		}
+		analyzeGrid(solution, &analysis);
+
+		for (int i = 1; i < PUZZLES_PER_GRID; i++) {
+			emptyCells = generatePuzzleFromGrid(&analysis, puzzle);
+			printf("Puzzle %d of %d, %d cells filled in:\n", i, PUZZLES_PER_GRID, rules.cellCount - emptyCells);
+			printBoard(puzzle);
+			printf("\n\n");
+		}
+		printf("Puzzle %d of %d:\n", PUZZLES_PER_GRID, PUZZLES_PER_GRID);
+		emptyCells = generatePuzzleFromGrid(&analysis, puzzle);
+	}
+	else if (rules.variant == KILLER) {
+		/* Killer puzzles build their cages on a random solution board before digging out the given cells */
+		emptyCells = generateKillerPuzzle(puzzle, solution);
+		printCages();
+		printf("\n\n");
+	}
+	else {
+		/* First we generate a random and complete solution board */
+		if (!generateBoard(puzzle))
+			printf("Warning, error generating a Sudoku puzzle.\n");
+
+		/* Make a Sudoku puzzle from a complete board, by default removing cells until
+		 * the further removal of any cell on the board would result in a 
+		 * non-unique solution.
+		 */ 	
+		emptyCells = generateWithStrategy(GENERATION_STRATEGY, puzzle, solution, MAX_EMPTY);
+	}
+	   
+	/* Print the problem board */
+	printBoard(puzzle);
+	printf("\n\n");
+
+	/* Wait for user input before displaying a solution */
+	printf("There are %d cells already filled in on this Sudoku board.\n", rules.cellCount - emptyCells);
+	printf("Press ENTER to display the solution.\n");
+    scanf("%c", &pressEnter);
+
+	/* Display the solution to the puzzle*/
+	printBoard(solution);
+	printf("\n\n");
+
+	return 0;
+}
+
+/* Compile the all-different regions of a puzzle variant into the global rules tables.
+ * Every variant starts from the rows and columns, then adds its own regions. Once all regions are added
+ * the peers of each cell are collected so that the solver only ever scans a flat list of cells.
+ *
+ * Returns TRUE if the variant could be built for this board SIZE, FALSE otherwise
+ */
+
+int buildRules(int variant) {
+	int squareSize = SQUARE_SIZE;      // The length of a sub-square
+	int cells[SIZE];                   // The cell numbers of a region being added
+
+	rules.variant = variant;
+	rules.regionCount = 0;
+	rules.cageCount = 0;
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		rules.cellRegionCount[cell] = 0;
+		rules.cageOf[cell] = NO_CAGE;
+	}
+
+	if (variant == KILLER) {
+		// The cages are only known once a solution board exists, here the combination tables are prepared
+		buildCageTables();
+	}
+
+	if (variant == SAMURAI) {
+		// A board built for one grid can't hold the five grids of a Samurai
+		if (GRID_WIDTH == SIZE) {
+			return FALSE;
+		}
+		int far = GRID_WIDTH - SIZE;  // The offset of the grids in the far corners
+		int middle = SIZE - squareSize;  // The offset of the centre grid, overlapping one sub-square of each corner grid
+		addGrid(0, 0, TRUE);
+		addGrid(0, far, TRUE);
+		addGrid(far, 0, TRUE);
+		addGrid(far, far, TRUE);
+		addGrid(middle, middle, TRUE);  // Its corner sub-squares are already there and are not added twice
+	}
+	else if (variant == JIGSAW) {
+		// Each letter of the layout names one irregular region, which must hold exactly SIZE cells
+		if (jigsawLayout == NULL) {
+			return FALSE;
+		}
+		addGrid(0, 0, FALSE);
+		for (int region = 0; region < SIZE; region++) {
+			int count = 0;
+			for (int cell = 0; cell < GRID_CELLS; cell++) {
+				if (jigsawLayout[cell] - 'A' == region) {
+					if (count == SIZE) {
+						return FALSE;
+					}
+					cells[count++] = cell;
+				}
+			}
+			if (count != SIZE) {
+				return FALSE;
+			}
+			addRegion(cells);
+		}
+	}
+	else {
+		addGrid(0, 0, TRUE);
+	}
+
+	if (variant == X_SUDOKU) {
+		for (int i = 0; i < SIZE; i++) {
+			cells[i] = i * GRID_WIDTH + i;  // The main diagonal
+		}
+		addRegion(cells);
+		for (int i = 0; i < SIZE; i++) {
+			cells[i] = i * GRID_WIDTH + (SIZE - 1 - i);  // The anti-diagonal
+		}
+		addRegion(cells);
+	}
+
+	if (variant == WINDOKU) {
+		/* The windows sit one cell in from the edges with one cell of space between them
+		 * e.g. for a 9x9 board the windows start at rows and columns 1 and 5
+		 */
+		for (int yWindow = 1; yWindow + squareSize < SIZE; yWindow += squareSize + 1) {
+			for (int xWindow = 1; xWindow + squareSize < SIZE; xWindow += squareSize + 1) {
+				for (int k = 0; k < SIZE; k++) {
+					cells[k] = (yWindow + k / squareSize) * GRID_WIDTH + xWindow + k % squareSize;
+				}
+				addRegion(cells);
+			}
+		}
+	}
+
+	// The cells covered by a region make up the puzzle
+	rules.cellCount = 0;
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		rules.active[cell] = (rules.cellRegionCount[cell] > 0);
+		rules.cellCount += rules.active[cell];
+	}
+
+	compilePeers();
+	buildSymmetries();
+	return TRUE;
+}
+
+/* Find the rotations and reflections of the board that keep the rules, i.e. move every region onto a region.
+ * All 8 keep the rules of CLASSIC, X_SUDOKU, WINDOKU and SAMURAI, a JIGSAW layout usually only keeps the
+ * identity. Killer cages change with every puzzle, so a KILLER board only keeps the identity.
+ */
+void buildSymmetries(void) {
+	int last = GRID_WIDTH - 1;
+
+	rules.symmetryCount = 0;
+	for (int s = 0; s < MAX_SYMMETRIES; s++) {
+		int* map = rules.symmetries[rules.symmetryCount];
+		for (int y = 0; y < GRID_WIDTH; y++) {
+			for (int x = 0; x < GRID_WIDTH; x++) {
+				int tx = (s & 1) ? last - x : x;  // Bit 0 reflects left to right
+				int ty = (s & 2) ? last - y : y;  // Bit 1 reflects top to bottom
+				map[y * GRID_WIDTH + x] = (s & 4) ? tx * GRID_WIDTH + ty : ty * GRID_WIDTH + tx;  // Bit 2 transposes
+			}
+		}
+
+		int keeps = (s == 0 || rules.variant != KILLER);
+		for (int cell = 0; keeps && cell < GRID_CELLS; cell++) {
+			keeps = (rules.active[cell] == rules.active[map[cell]]);
+		}
+		// A region is moved onto a region if one region holds the images of all of its cells
+		for (int region = 0; keeps && region < rules.regionCount; region++) {
+			int first = map[rules.regionCells[region][0]];
+			int found = FALSE;
+			for (int r = 0; !found && r < rules.cellRegionCount[first]; r++) {
+				int image = rules.cellRegions[first][r];
+				found = TRUE;
+				for (int k = 1; found && k < SIZE; k++) {
+					int cell = map[rules.regionCells[region][k]];
+					int member = FALSE;
+					for (int q = 0; q < rules.cellRegionCount[cell]; q++) {
+						member |= (rules.cellRegions[cell][q] == image);
+					}
+					found = member;
+				}
+			}
+			keeps = found;
+		}
+		rules.symmetryKinds[rules.symmetryCount] = s;
+		rules.symmetryCount += keeps;
+	}
+}
+
+/* Add the regions of one SIZE x SIZE grid whose top left cell is at {xOffset, yOffset} on the board:
+ * its rows, its columns and, when squares is TRUE, its sub-squares numbered row by row
+ */
+void addGrid(int yOffset, int xOffset, int squares) {
+	int cells[SIZE];  // The cell numbers of a region being added
+
+	for (int i = 0; i < SIZE; i++) {
+		for (int j = 0; j < SIZE; j++) {
+			cells[j] = (yOffset + i) * GRID_WIDTH + xOffset + j;  // Row i
+		}
+		addRegion(cells);
+		for (int j = 0; j < SIZE; j++) {
+			cells[j] = (yOffset + j) * GRID_WIDTH + xOffset + i;  // Column i
+		}
+		addRegion(cells);
+	}
+
+	for (int square = 0; square < SIZE && squares; square++) {
+		int yMin = yOffset + (square / SQUARE_SIZE) * SQUARE_SIZE;
+		int xMin = xOffset + (square % SQUARE_SIZE) * SQUARE_SIZE;
+		for (int k = 0; k < SIZE; k++) {
+			cells[k] = (yMin + k / SQUARE_SIZE) * GRID_WIDTH + xMin + k % SQUARE_SIZE;
+		}
+		addRegion(cells);
+	}
+}
+
+/* Collect the peers of every cell from the regions and cages of the global rules.
+ * Each peer is listed once even if it shares several regions with the cell.
+ */
+void compilePeers(void) {
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		int isPeer[GRID_CELLS] = { 0 };
+		rules.peerCount[cell] = 0;
+		for (int r = 0; r < rules.cellRegionCount[cell]; r++) {
+			int region = rules.cellRegions[cell][r];
+			for (int k = 0; k < SIZE; k++) {
+				int peer = rules.regionCells[region][k];
+				if (peer != cell && !isPeer[peer]) {
+					isPeer[peer] = TRUE;
+					rules.peers[cell][rules.peerCount[cell]++] = peer;
+				}
+			}
+		}
+		// The other cells of a cage must also hold different integers
+		if (rules.cageOf[cell] != NO_CAGE) {
+			int cage = rules.cageOf[cell];
+			for (int k = 0; k < rules.cageSize[cage]; k++) {
+				int peer = rules.cageCells[cage][k];
+				if (peer != cell && !isPeer[peer]) {
+					isPeer[peer] = TRUE;
+					rules.peers[cell][rules.peerCount[cell]++] = peer;
+				}
+			}
+		}
+	}
+}
+
+/* Fill the Killer sum-combination tables with every set of at most MAX_CAGE_SIZE different integers.
+ * The sets are enumerated as the bit patterns of a combination counter, counted into (count, sum) buckets
+ * in a first pass, and written into their bucket slices in a second pass.
+ */
+void buildCageTables(void) {
+	int fill[MAX_CAGE_SIZE + 1][MAX_SUM + 2] = { 0 };  // The number of sets per (count, sum), then the write positions
+	int list[MAX_CAGE_SIZE];                          // The integers of the current set, in increasing order
+
+	for (int pass = 0; pass < 2; pass++) {
+		// Walk through every set of integers of each count with a combination counter
+		for (int count = 0; count <= MAX_CAGE_SIZE && count <= SIZE; count++) {
+			for (int k = 0; k < count; k++) {
+				list[k] = k + 1;
+			}
+			int more = TRUE;
+			while (more) {
+				DigitMask digits = 0;
+				int sum = 0;
+				for (int k = 0; k < count; k++) {
+					digits |= (DigitMask)1 << list[k];
+					sum += list[k];
+				}
+				if (pass == 0) {
+					fill[count][sum]++;
+				}
+				else {
+					cageTables.comboMasks[fill[count][sum]++] = digits;
+				}
+
+				// Advance to the next set: bump the last integer that still has room to grow
+				int k = count - 1;
+				while (k >= 0 && list[k] == SIZE - (count - 1 - k)) {
+					k--;
+				}
+				if (k < 0) {
+					more = FALSE;
+				}
+				else {
+					list[k]++;
+					for (int j = k + 1; j < count; j++) {
+						list[j] = list[j - 1] + 1;
+					}
+				}
+			}
+		}
+
+		if (pass == 0) {
+			// Turn the bucket sizes into slice starts, which are also the write positions of the second pass
+			int start = 0;
+			for (int count = 0; count <= MAX_CAGE_SIZE; count++) {
+				for (int sum = 0; sum <= MAX_SUM; sum++) {
+					int size = fill[count][sum];
+					cageTables.comboStart[count][sum] = start;
+					fill[count][sum] = start;
+					start += size;
+				}
+				cageTables.comboStart[count][MAX_SUM + 1] = start;
+			}
+		}
+	}
+}
+
+/* Divide a complete solution board into random Killer cages. Every cage starts at a random unassigned cell
+ * and grows through random neighbouring cells (up, down, left, right) whose integers are not yet in the cage,
+ * up to a random size of 1 - MAX_CAGE_SIZE cells. The cage sums are read from the board.
+ *
+ * Returns the number of cages built
+ */
+int buildCages(int board[][GRID_WIDTH]) {
+	int listOfCells[GRID_CELLS];  // The cells in a random order to seed cages from
+	int xStep[4] = { 1, -1, 0, 0 };
+	int yStep[4] = { 0, 0, 1, -1 };
+
+	rules.cageCount = 0;
+	for (int i = 0; i < GRID_CELLS; i++) {
+		listOfCells[i] = i;
+		rules.cageOf[i] = NO_CAGE;
+	}
+	shuffleValues(listOfCells, GRID_CELLS);
+
+	for (int i = 0; i < GRID_CELLS; i++) {
+		int seed = listOfCells[i];
+		if (rules.cageOf[seed] != NO_CAGE || !rules.active[seed]) {
+			continue;
+		}
+
+		int cage = rules.cageCount++;
+		int targetSize = 1 + randomInt(MAX_CAGE_SIZE < SIZE ? MAX_CAGE_SIZE : SIZE);
+		DigitMask used = (DigitMask)1 << board[seed / GRID_WIDTH][seed % GRID_WIDTH];
+
+		rules.cageCells[cage][0] = seed;
+		rules.cageSize[cage] = 1;
+		rules.cageSum[cage] = board[seed / GRID_WIDTH][seed % GRID_WIDTH];
+		rules.cageOf[seed] = cage;
+
+		while (rules.cageSize[cage] < targetSize) {
+			// Gather every free neighbour of the cage that would not repeat an integer
+			int options[MAX_CAGE_SIZE * 4];
+			int optionCount = 0;
+			for (int k = 0; k < rules.cageSize[cage]; k++) {
+				int cell = rules.cageCells[cage][k];
+				for (int d = 0; d < 4; d++) {
+					int x = cell % GRID_WIDTH + xStep[d];
+					int y = cell / GRID_WIDTH + yStep[d];
+					if (x >= 0 && x < GRID_WIDTH && y >= 0 && y < GRID_WIDTH && rules.active[y * GRID_WIDTH + x]
+						&& rules.cageOf[y * GRID_WIDTH + x] == NO_CAGE && !(used & ((DigitMask)1 << board[y][x]))) {
+						options[optionCount++] = y * GRID_WIDTH + x;
+					}
+				}
+			}
+			if (optionCount == 0) {
+				break;  // The cage is boxed in, keep it smaller than planned
+			}
+
+			int cell = options[randomInt(optionCount)];
+			used |= (DigitMask)1 << board[cell / GRID_WIDTH][cell % GRID_WIDTH];
+			rules.cageCells[cage][rules.cageSize[cage]++] = cell;
+			rules.cageSum[cage] += board[cell / GRID_WIDTH][cell % GRID_WIDTH];
+			rules.cageOf[cell] = cage;
+		}
+	}
+
+	compilePeers();  // Cage mates become peers of each other
+	return rules.cageCount;
+}
+
+/* Append one all-different region of SIZE cells to the global rules.
+ * A region listing the same cells in the same order as an existing one (a sub-square shared by two
+ * Samurai grids) is skipped.
+ */
+void addRegion(int cells[SIZE]) {
+	for (int r = 0; r < rules.cellRegionCount[cells[0]]; r++) {
+		int existing = rules.cellRegions[cells[0]][r];
+		int k = 0;
+		while (k < SIZE && rules.regionCells[existing][k] == cells[k]) {
+			k++;
+		}
+		if (k == SIZE) {
+			return;
+		}
+	}
+
+	int region = rules.regionCount++;
+
+	for (int k = 0; k < SIZE; k++) {
+		int cell = cells[k];
+		rules.regionCells[region][k] = cell;
+		rules.cellRegions[cell][rules.cellRegionCount[cell]++] = region;
+	}
+}
+
+/* Generate a blank Sudoku board and then fill it with randomized 
+ *  legal values, return 1 if successful
+ *  The fill is restarted from a blank board whenever an attempt runs out of fillBudget
+ */
+
+int generateBoard(int board[][GRID_WIDTH]) {
+
+	int filled = FALSE;
+
+	TRACE_BEGIN("generateBoard");
+	while (!filled) {
+		//initialize the board with 0s
+		for (int i = 0; i < GRID_WIDTH; i++) {
+			for (int j = 0; j < GRID_WIDTH; j++) {
+				board[i][j] = 0;
+			}
+		}
+
+		fillBudget = FILL_RESTART_NODES;
+		filled = randomFillBoard(board); // Fill the empty board with random values
+		generationStats.fillNodes += FILL_RESTART_NODES - fillBudget;
+		generationStats.fillRestarts += !filled;
+	}
+	TRACE_END();
+
+	return 1; // return 1 if successful
+}
+
+/* Fill a Sudoku board with pseudo-random values using recursive backtracking.
+ * All filled cells must be legal within the rules of Sudoku.
+ *
+ * Input: an empty or partially filled Sudoku board
+ * Output: Return TRUE if board has been filled, 
+ *         FALSE if the board is unsolvable (no legal moves) or the fillBudget ran out
+ */
+
+int randomFillBoard(int board[][GRID_WIDTH]) {
+	int xPos = 0; // Column index of a Sudoku cell
+	int yPos = 0; // Row index of a Sudoku cell
+	
+	int validIntegers[SIZE] = { 0 }; // List of valid integers for a cell in randomized order 
+	int listSize;  // The number of items in a list of valid integers
+
+	int solved = FALSE; // Indicates if the board has been completely filled with legal values
+
+	if (fillBudget-- <= 0) {  // This attempt has visited too many cells, give up so the caller can start over
+		solved = FALSE;
+	}
+	else if ( !(nextEmpty(board, &xPos, &yPos)) ){ // Find the next empty cell on the board,
+											 // If there are no more empty cells
+		solved = TRUE;                       // Then the board has been completed (solved) 
+
+	}else{ // The board isn't solved yet so continue solving
+
+		// Next, get a list of permitted values for the empty cell, if there are no
+		// Permitted values, then the board is unsolvable, return FALSE
+		listSize = getValidIntegers(board, xPos, yPos, validIntegers);
+		if (listSize <= 0) {
+			// No valid integers, the board is unsolvable
+			solved = FALSE;
+		}
+		else {  // There are valid integers for substitution, try substituting each one until solution found
+			
+			// Shuffle the list of valid integers to ensure randomness
+			shuffleValues(validIntegers, listSize);
+
+			/* Try putting each legal value int the list into the empty Sudoku cell 
+			 * until a solution is found (while !solved), use recursion with backtracking here
+			 */
+			for (int i = 0; i < listSize && !solved; i++) { 
+
+				/* Replace the empty position with a shuffled valid integer */
+				board[yPos][xPos] = validIntegers[i];
+				
+				/* This is the recursion step to make sure the substitution leads to a solution*/
+				solved = randomFillBoard(board);  
+
+				/* if there is no solution found for this branch, then it is important to replace the Sudoku cell
+				 * with an EMPTY value, since the array is shared across all iterations of the function
+				 */
+				if (!solved) {
+					board[yPos][xPos] = EMPTY;
+				}				
+			}
+		}
+	}
+	return solved;
+}
+
+/*  Takes a completed and legal Sudoku board and removes random cells from it until there 
+ *  is only one unique solution to the puzzle. Uses a list of all the cells on the board, 
+ *  numbered from 0 - SIZE^2 - 1 -- e.g. for a 9x9 board there are 81 positions numbered from 0 - 80
+ *  (a SAMURAI board numbers all GRID_CELLS positions the same way, and only its active cells are listed)
+ *   
+ *    i. e.  0  1  2  |  3  4  5  |  6  7  8
+ *           9  10 11 |  12 13 14 |  15 16 17
+ *           . . . . . . . . . . . . . . . . 
+ *           72 73 74 |  75 76 77 |  78 79 80
+ *
+ *  Removes numbers one at a time until the next removal would result in a non unique-solution puzzle,
+ *  or until maxEmpty cells have been removed
+ *  
+ *  Returns the value of the number of cells that were emptied from the solution to form the puzzle
+ */
+
+int generatePuzzle(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty) {
+
+	int listOfCells[GRID_CELLS] = { 0 };  // A list of numbered cell values
+	int listSize = 0;  // The number of cells in the list
+
+	// The full board is the solution of every puzzle dug out of it
+	duplicateBoard(board, solution);
+
+	// Initialize the list with the active cells
+	for (int i = 0; i < GRID_CELLS; i++) {
+		if (rules.active[i]) {
+			listOfCells[listSize++] = i;
+		}
+	}
+
+	// Shuffle the list to randomize order
+	shuffleValues(listOfCells, listSize);
+
+	// Empty the cell values in the list one by one until a unique-solution puzzle has been made.
+	return digCells(board, listOfCells, listSize, maxEmpty);
+}
+
+/* Try emptying each cell of a list in turn, keeping a cell empty only if the board still has a unique solution.
+ * The board must have a unique solution to begin with. Stops once maxRemovals cells have been emptied.
+ *
+ * Returns the number of cells that were emptied
+ */
+
+int digCells(int board[][GRID_WIDTH], int listOfCells[], int listSize, int maxRemovals) {
+
+	int cellNumber;  // A number representing a Sudoku cell from 0 - GRID_CELLS
+	int scratch[GRID_WIDTH][GRID_WIDTH];  // Receives the solutions found by the uniqueness checks
+
+	int xPos; // The x position of a Sudoku cell
+	int yPos; // The y position of a Sudoku cell
+	int cellValue; // The value read from a Sudoku cell
+
+	int removedCount = 0;  // Count how many cells have been successfully emptied from the full board
+	int solutions = 0;  // Tracks the solutions found by removing the number
+
+	int index = 0;
+	while (index < listSize &&  removedCount < maxRemovals) {
+		
+		cellNumber = listOfCells[index]; // Draw the next randomized cell postion from the list
+
+		// Convert the cellNumber to an {x,y} postion on the board
+		yPos = (cellNumber / GRID_WIDTH);  //Integer division conveniently yields the y position
+		xPos = (cellNumber % GRID_WIDTH);  //And the remainder is the x postion
+
+		// Try removing the cell to see if removing it prevents a unique solution, while holding removed value in memory
+		cellValue = board[yPos][xPos];
+		board[yPos][xPos] = EMPTY;
+
+		// Determine number of potential solutions after emptying the most recent cell,
+		// the counting can stop at a second solution since that already rules out the removal
+		solutions = uniquenessCheck(board, scratch, 2);
+
+		// If there is more than one solution now, the cell can't be removed without violating
+		// creating a unique solution.  Replace the cell's value and continue the loop
+		if (solutions > 1) {      
+			board[yPos][xPos] = cellValue;							
+			generationStats.rejected++;
+		}
+		else {
+			removedCount++;
+			generationStats.accepted++;
+		}
+		index++;		
+	}
+	return removedCount;
+}
+
+/* Same as generatePuzzle(), but the cells are emptied in blocks by digCellsBatched() instead of one at a time.
+ * The puzzle is exactly the one generatePuzzle() would make from the same shuffled list, with fewer checks.
+ *
+ * Returns the value of the number of cells that were emptied from the solution to form the puzzle
+ */
+
+int generatePuzzleBatched(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty) {
+
+	int listOfCells[GRID_CELLS] = { 0 };  // A list of numbered cell values
+	int listSize = 0;  // The number of cells in the list
+
+	duplicateBoard(board, solution);
+
+	for (int i = 0; i < GRID_CELLS; i++) {
+		if (rules.active[i]) {
+			listOfCells[listSize++] = i;
+		}
+	}
+	shuffleValues(listOfCells, listSize);
+
+	return digCellsBatched(board, listOfCells, listSize, maxEmpty);
+}
+
+/* Empty the cells of a list like digCells(), but a block of cells at a time with one uniqueness check.
+ * Emptying a block keeps the solution unique only if emptying each of its cells in turn would, so a block that
+ * passes is accepted whole and a block that fails is bisected by digBlock() to find the cells to keep. This
+ * gives exactly the result of digCells() on the same list. Early on nearly every removal succeeds, so the
+ * blocks start at BATCH_START cells and double after each clean block (up to BATCH_MAX), and halve after a
+ * block that needed bisecting, as failures become common on a sparse board.
+ *
+ * Returns the number of cells that were emptied
+ */
+
+int digCellsBatched(int board[][GRID_WIDTH], int listOfCells[], int listSize, int maxRemovals) {
+
+	int removedCount = 0;  // Count how many cells have been successfully emptied
+	int blockSize = BATCH_START;  // The number of cells to try in the next block
+	int index = 0;  // The first cell of the next block in the list
+
+	while (index < listSize && removedCount < maxRemovals) {
+		// The block can't run past the list or empty more cells than allowed
+		int size = blockSize;
+		if (size > listSize - index) {
+			size = listSize - index;
+		}
+		if (size > maxRemovals - removedCount) {
+			size = maxRemovals - removedCount;
+		}
+
+		int allRemoved = TRUE;
+		removedCount += digBlock(board, &listOfCells[index], size, FALSE, &allRemoved);
+		index += size;
+
+		if (allRemoved) {
+			blockSize = (blockSize * 2 > BATCH_MAX) ? BATCH_MAX : blockSize * 2;
+		}
+		else {
+			blockSize = (blockSize / 2 < 1) ? 1 : blockSize / 2;
+		}
+	}
+	return removedCount;
+}
+
+/* Try emptying a block of cells with one uniqueness check. If the board no longer has a unique solution,
+ * the cells are put back and each half of the block is tried in turn (recursively), the second half
+ * on top of whatever the first half managed to empty. allRemoved is set to FALSE if any cell had to stay.
+ * knownToFail skips the check of the whole block, for a second half whose first half was emptied whole: the
+ * board is then the one the failed check of their parent block saw.
+ *
+ * Returns the number of cells of the block that were emptied
+ */
+
+int digBlock(int board[][GRID_WIDTH], int block[], int blockSize, int knownToFail, int* allRemoved) {
+
+	int values[BATCH_MAX];  // The values of the block, to put them back on failure
+	int scratch[GRID_WIDTH][GRID_WIDTH];  // Receives the solutions found by the uniqueness check
+
+	if (!knownToFail) {
+		for (int i = 0; i < blockSize; i++) {
+			values[i] = board[block[i] / GRID_WIDTH][block[i] % GRID_WIDTH];
+			board[block[i] / GRID_WIDTH][block[i] % GRID_WIDTH] = EMPTY;
+		}
+
+		if (uniquenessCheck(board, scratch, 2) <= 1) {
+			generationStats.accepted += blockSize;
+			return blockSize;  // Every cell of the block can go
+		}
+
+		for (int i = 0; i < blockSize; i++) {
+			board[block[i] / GRID_WIDTH][block[i] % GRID_WIDTH] = values[i];
+		}
+	}
+	if (blockSize == 1) {
+		*allRemoved = FALSE;  // This cell is needed for a unique solution
+		generationStats.rejected++;
+		return 0;
+	}
+
+	int half = blockSize / 2;
+	int removed = digBlock(board, block, half, FALSE, allRemoved);
+	return removed + digBlock(board, &block[half], blockSize - half, removed == half, allRemoved);
+}
+
+/* Prepare a solution board for making many puzzles from it: keep a copy and find its unavoidable sets.
+ * Every rectangle of four active cells holding a b / b a is checked by swapping a and b and testing the
+ * result against all the regions and cages, so the sets are correct for any variant.
+ */
+
+void analyzeGrid(int grid[][GRID_WIDTH], GridAnalysis* analysis) {
+
+	int swapped[GRID_WIDTH][GRID_WIDTH];  // The board with the integers of a rectangle swapped
+
+	duplicateBoard(grid, analysis->grid);
+	duplicateBoard(grid, swapped);
+	analysis->setCount = 0;
+
+	for (int y1 = 0; y1 < GRID_WIDTH; y1++) {
+		for (int y2 = y1 + 1; y2 < GRID_WIDTH; y2++) {
+			for (int x1 = 0; x1 < GRID_WIDTH; x1++) {
+				for (int x2 = x1 + 1; x2 < GRID_WIDTH && analysis->setCount < MAX_UNAVOIDABLE; x2++) {
+					int corners[4] = { y1 * GRID_WIDTH + x1, y1 * GRID_WIDTH + x2, y2 * GRID_WIDTH + x1, y2 * GRID_WIDTH + x2 };
+					if (!rules.active[corners[0]] || !rules.active[corners[1]] || !rules.active[corners[2]] || !rules.active[corners[3]]
+						|| grid[y1][x1] != grid[y2][x2] || grid[y1][x2] != grid[y2][x1]) {
+						continue;
+					}
+
+					// Swap the pair and see if the board is still valid
+					swapped[y1][x1] = swapped[y2][x2] = grid[y1][x2];
+					swapped[y1][x2] = swapped[y2][x1] = grid[y1][x1];
+					if (boardIsValid(swapped)) {
+						for (int k = 0; k < 4; k++) {
+							analysis->setCells[analysis->setCount][k] = corners[k];
+						}
+						analysis->setCount++;
+					}
+					swapped[y1][x1] = swapped[y2][x2] = grid[y1][x1];
+					swapped[y1][x2] = swapped[y2][x1] = grid[y1][x2];
+				}
+			}
+		}
+	}
+}
+
+/* Make a puzzle from an analyzed solution board, digging holes in a fresh random order like generatePuzzle().
+ * Two pieces of the analysis save uniqueness checks:
+ *  - a cell that is the last clue left in one of the unavoidable sets is kept without any search
+ *  - since the solution is known, removing a cell keeps it unique exactly when no other integer placed in
+ *    that cell leads to a solution, which is checked with searches that stop at the first solution
+ *
+ * Returns the number of cells that were emptied from the solution to form the puzzle in board[][]
+ */
+
+int generatePuzzleFromGrid(GridAnalysis* analysis, int board[][GRID_WIDTH]) {
+
+	int listOfCells[GRID_CELLS] = { 0 };  // A list of numbered cell values
+	int listSize = 0;
+	int removedCount = 0;
+
+	duplicateBoard(analysis->grid, board);
+	for (int i = 0; i < GRID_CELLS; i++) {
+		if (rules.active[i]) {
+			listOfCells[listSize++] = i;
+		}
+	}
+	shuffleValues(listOfCells, listSize);
+
+	for (int index = 0; index < listSize && removedCount < MAX_EMPTY; index++) {
+		int cell = listOfCells[index];
+		int yPos = cell / GRID_WIDTH;
+		int xPos = cell % GRID_WIDTH;
+
+		// A cell holding the last clue of an unavoidable set can't go
+		int lastClue = FALSE;
+		for (int set = 0; set < analysis->setCount && !lastClue; set++) {
+			int clues = 0;
+			int inSet = FALSE;
+			for (int k = 0; k < 4; k++) {
+				int setCell = analysis->setCells[set][k];
+				inSet |= (setCell == cell);
+				clues += (board[setCell / GRID_WIDTH][setCell % GRID_WIDTH] != EMPTY);
+			}
+			lastClue = inSet && clues == 1;
+		}
+		if (lastClue) {
+			generationStats.rejected++;
+			continue;
+		}
+
+		if (removalKeepsUnique(board, xPos, yPos, analysis->grid[yPos][xPos])) {
+			board[yPos][xPos] = EMPTY;
+			removedCount++;
+			generationStats.accepted++;
+		}
+		else {
+			generationStats.rejected++;
+		}
+	}
+	return removedCount;
+}
+
+/* Check whether emptying a cell of a board with a unique solution keeps the solution unique, knowing that the
+ * cell holds value in that solution. Any other solution would need a different integer in the cell, so each
+ * other legal integer is placed in turn and a single solution from there is enough to refuse the removal.
+ * The board is left unchanged.
+ *
+ * Returns TRUE if the cell can be emptied
+ */
+
+int removalKeepsUnique(int board[][GRID_WIDTH], int xPos, int yPos, int value) {
+	int validIntegers[SIZE];
+	int scratch[GRID_WIDTH][GRID_WIDTH];
+	int unique = TRUE;
+
+	board[yPos][xPos] = EMPTY;
+	int listSize = getValidIntegers(board, xPos, yPos, validIntegers);
+	for (int i = 0; i < listSize && unique; i++) {
+		if (validIntegers[i] != value) {
+			board[yPos][xPos] = validIntegers[i];
+			unique = (uniquenessCheck(board, scratch, 1) == 0);
+		}
+	}
+	board[yPos][xPos] = value;
+	return unique;
+}
+
+/* Count the solutions of a board like countSolutions() for a generator testing a removal or a set of clues,
+ * adding the search to the generationStats of the thread by the number of empty cells of the board.
+ *
+ * Returns the number of solutions found, at most limit
+ */
+
+int uniquenessCheck(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit) {
+	int emptyCells = 0;
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		emptyCells += (rules.active[cell] && board[cell / GRID_WIDTH][cell % GRID_WIDTH] == EMPTY);
+	}
+
+	unsigned long long startNodes = backtrackCount;
+	int solutions = countSolutions(board, solution, limit);
+
+	generationStats.checks++;
+	generationStats.checkNodes += backtrackCount - startNodes;
+	generationStats.emptyChecks[emptyCells]++;
+	generationStats.emptyNodes[emptyCells] += backtrackCount - startNodes;
+	return solutions;
+}
+
+/* Check that a full board obeys the rules: every region holds each integer once and every Killer cage
+ * holds different integers adding up to its sum.
+ *
+ * Returns TRUE if the board is a valid solution
+ */
+
+int boardIsValid(int board[][GRID_WIDTH]) {
+	const int* cells = &board[0][0];
+
+	for (int region = 0; region < rules.regionCount; region++) {
+		DigitMask seen = 0;
+		for (int k = 0; k < SIZE; k++) {
+			seen |= (DigitMask)1 << cells[rules.regionCells[region][k]];
+		}
+		if (seen != ALL_DIGITS) {
+			return FALSE;
+		}
+	}
+	for (int cage = 0; cage < rules.cageCount; cage++) {
+		DigitMask seen = 0;
+		int sum = 0;
+		for (int k = 0; k < rules.cageSize[cage]; k++) {
+			int value = cells[rules.cageCells[cage][k]];
+			seen |= (DigitMask)1 << value;
+			sum += value;
+		}
+		if (sum != rules.cageSum[cage] || countDigits(seen) != rules.cageSize[cage] || (seen & 1)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Make a puzzle from a complete and legal Sudoku board by building up clues instead of digging holes.
+ * The puzzle starts with a few random clues from the board (at least enough to respect maxEmpty). While the
+ * puzzle has a second solution, a clue is added from the board at a random cell where that other solution
+ * disagrees, which rules it out. Each round costs one count-limited search instead of one search per cell.
+ * Once the solution is unique the clues can be pruned (prune = TRUE), removing any that became redundant.
+ *
+ * Returns the number of cells that are empty in the puzzle left on the board
+ */
+
+int generatePuzzleBuildUp(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int prune, int maxEmpty) {
+
+	int other[GRID_WIDTH][GRID_WIDTH];  // A solution of the puzzle that differs from the board
+	int listOfCells[GRID_CELLS];  // The active cells, shuffled, then the differing cells of a round
+	int listSize = 0;
+	int clueCount;  // The number of clues in the puzzle
+
+	// The full board is the target solution
+	duplicateBoard(board, solution);
+
+	for (int i = 0; i < GRID_CELLS; i++) {
+		if (rules.active[i]) {
+			listOfCells[listSize++] = i;
+		}
+	}
+	shuffleValues(listOfCells, listSize);
+
+	// Keep the first clueCount shuffled cells as the starting clues and empty the rest
+	clueCount = rules.cellCount - maxEmpty > SIZE ? rules.cellCount - maxEmpty : SIZE;
+	for (int i = clueCount; i < listSize; i++) {
+		board[listOfCells[i] / GRID_WIDTH][listOfCells[i] % GRID_WIDTH] = EMPTY;
+	}
+
+	/* Count up to two solutions, the last one found is kept in other[]. The target is always one of them,
+	 * so if other[] is the target then the first solution found is the one that differs, and a search
+	 * limited to one solution finds it again since the search order does not change.
+	 */
+	while (uniquenessCheck(board, other, 2) > 1) {
+		int differs = FALSE;
+		for (int cell = 0; cell < GRID_CELLS && !differs; cell++) {
+			differs = (other[cell / GRID_WIDTH][cell % GRID_WIDTH] != solution[cell / GRID_WIDTH][cell % GRID_WIDTH]);
+		}
+		if (!differs) {
+			uniquenessCheck(board, other, 1);
+		}
+
+		// Collect the empty cells where the two solutions disagree and reveal a random one of them
+		int differCount = 0;
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			int yPos = cell / GRID_WIDTH;
+			int xPos = cell % GRID_WIDTH;
+			if (rules.active[cell] && board[yPos][xPos] == EMPTY && other[yPos][xPos] != solution[yPos][xPos]) {
+				listOfCells[differCount++] = cell;
+			}
+		}
+		int cell = listOfCells[randomInt(differCount)];
+		board[cell / GRID_WIDTH][cell % GRID_WIDTH] = solution[cell / GRID_WIDTH][cell % GRID_WIDTH];
+		clueCount++;
+	}
+
+	if (prune) {
+		// Try removing every clue once, in random order
+		listSize = 0;
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			if (rules.active[cell] && board[cell / GRID_WIDTH][cell % GRID_WIDTH] != EMPTY) {
+				listOfCells[listSize++] = cell;
+			}
+		}
+		shuffleValues(listOfCells, listSize);
+		clueCount -= digCells(board, listOfCells, listSize, maxEmpty - (rules.cellCount - clueCount));
+	}
+
+	return rules.cellCount - clueCount;
+}
+
+/* Make a puzzle from a complete and legal Sudoku board in board[][] with one of the generation strategies
+ * (DIG_HOLES, BUILD_UP or BATCH_REMOVAL), leaving at most maxEmpty empty cells.
+ * The puzzle is left in board[][] and the complete board in solution[][].
+ *
+ * Returns the number of cells that were emptied from the solution to form the puzzle
+ */
+
+int generateWithStrategy(int strategy, int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int maxEmpty) {
+	int emptied;
+
+	TRACE_BEGIN("generatePuzzle");
+	if (strategy == BUILD_UP) {
+		emptied = generatePuzzleBuildUp(board, solution, PRUNE_CLUES, maxEmpty);
+	}
+	else if (strategy == BATCH_REMOVAL) {
+		emptied = generatePuzzleBatched(board, solution, maxEmpty);
+	}
+	else {
+		emptied = generatePuzzle(board, solution, maxEmpty);
+	}
+	TRACE_END();
+	return emptied;
+}
+
+/* Generate a Killer puzzle: a random solution board is divided into cages, then the given cells are removed
+ * by the GENERATION_STRATEGY for as long as the cages and the remaining givens still lead to a unique solution.
+ * The cages are left in the global rules for the solver and for printCages().
+ *
+ * Returns the number of cells that were emptied from the solution to form the puzzle
+ */
+
+int generateKillerPuzzle(int board[][GRID_WIDTH], int solution[][GRID_WIDTH]) {
+
+	if (!generateBoard(board))
+		return 0;
+
+	buildCages(board);
+
+	return generateWithStrategy(GENERATION_STRATEGY, board, solution, MAX_EMPTY);
+}
+
+/* Fill an order of puzzles with worker threads.
+ * Arguments: [-log <file>] <threads> <bucket>... where a bucket is grade:minClues-maxClues:count, e.g. hard:22-26:100
+ * The board SIZE and VARIANT are the ones the program was built with.
+ *
+ * Every worker repeatedly asks the scheduler (pickBucket) which bucket to aim for, makes a puzzle with at least
+ * as many clues as a random target in that bucket's range, grades it and hands it to routePuzzle(), which gives
+ * it to any unfilled bucket it qualifies for rather than throwing away a puzzle that missed its target.
+ * Accepted puzzles are written to stdout as: bucket grade clues board, with the board as one line of text.
+ * With -log they are appended to the file instead, and a checkpoint of the order is saved next to it every
+ * CHECKPOINT_SECONDS; running the same command again after a crash resumes the order from the log.
+ *
+ * Returns 0 once every bucket is filled, 1 for bad arguments or a log that can't be used
+ */
+
+int runOrder(int argc, char* argv[]) {
+	static GenerationOrder order;
+	thrd_t workers[MAX_THREADS];
+	int threadCount;
+	const char* logPath = NULL;
+
+	if (argc > 1 && strcmp(argv[0], "-log") == 0) {
+		logPath = argv[1];
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 2 || (threadCount = atoi(argv[0])) < 1 || threadCount > MAX_THREADS || argc - 1 > MAX_BUCKETS) {
+		fprintf(stderr, "Usage: order [-log <file>] <threads 1-%d> <grade:minClues-maxClues:count>... (up to %d buckets)\n",
+			MAX_THREADS, MAX_BUCKETS);
+		return 1;
+	}
+	if (VARIANT == KILLER) {
+		fprintf(stderr, "Orders of KILLER puzzles are not supported, the board text does not hold the cages.\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	memset(&order, 0, sizeof(order));
+	order.seed = randomState;
+	order.bucketCount = argc - 1;
+	for (int b = 0; b < order.bucketCount; b++) {
+		OrderBucket* bucket = &order.buckets[b];
+		char gradeName[16];
+		bucket->grade = -1;
+		if (sscanf(argv[b + 1], "%15[a-z]:%d-%d:%d", gradeName, &bucket->minClues, &bucket->maxClues, &bucket->wanted) == 4) {
+			for (int g = 0; g < GRADES; g++) {
+				if (strcmp(gradeName, gradeNames[g]) == 0) {
+					bucket->grade = g;
+				}
+			}
+		}
+		if (bucket->grade < 0 || bucket->minClues < 0 || bucket->minClues > bucket->maxClues
+			|| bucket->maxClues > rules.cellCount || bucket->wanted < 1) {
+			fprintf(stderr, "Bad bucket \"%s\", expected grade:minClues-maxClues:count with grade easy, medium or hard\n",
+				argv[b + 1]);
+			return 1;
+		}
+	}
+
+	order.output = stdout;
+	if (logPath != NULL && !openOrderLog(&order, logPath)) {
+		return 1;
+	}
+
+	mtx_init(&order.lock, mtx_plain);
+	for (int t = 0; t < threadCount; t++) {
+		thrd_create(&workers[t], orderWorker, &order);
+	}
+	for (int t = 0; t < threadCount; t++) {
+		thrd_join(workers[t], NULL);
+	}
+	mtx_destroy(&order.lock);
+
+	if (logPath != NULL) {
+		writeCheckpoint(&order);  // The final checkpoint says the order is complete
+		fclose(order.output);
+	}
+
+	// Report how each bucket was filled
+	fprintf(stderr, "%d puzzles made, %d discarded\n", order.produced, order.discarded);
+	for (int b = 0; b < order.bucketCount; b++) {
+		OrderBucket* bucket = &order.buckets[b];
+		fprintf(stderr, "bucket %d %s %d-%d: %d/%d filled, %d attempts, yield %.2f, %.3f s per attempt\n", b,
+			gradeNames[bucket->grade], bucket->minClues, bucket->maxClues, bucket->filled, bucket->wanted,
+			bucket->attempts, bucket->attempts ? (double)bucket->hits / bucket->attempts : 0.0,
+			bucket->attempts ? bucket->seconds / bucket->attempts : 0.0);
+	}
+	return 0;
+}
+
+/* The work loop of one thread of runOrder(), arg is the shared GenerationOrder.
+ * The thread compiles its own rules, and every attempt takes its random numbers from its attempt number so that
+ * a resumed order never repeats the attempts made before it stopped. A log records the attempt number of each
+ * puzzle after its board, for openOrderLog() to continue past the puzzles written after the checkpoint.
+ */
+int orderWorker(void* arg) {
+	GenerationOrder* order = (GenerationOrder*)arg;
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int solution[GRID_WIDTH][GRID_WIDTH];
+	char text[GRID_CELLS + 1];
+
+	buildRules(VARIANT);
+	TRACE_THREAD("order");
+
+	for (;;) {
+		mtx_lock(&order->lock);
+		int target = pickBucket(order);
+		unsigned long long attempt = order->nextAttempt;
+		if (target >= 0) {
+			order->buckets[target].inFlight++;
+			order->nextAttempt++;
+			seedRandom(streamSeed(order->seed, attempt));
+		}
+		int minClues = target >= 0 ? order->buckets[target].minClues : 0;
+		int maxClues = target >= 0 ? order->buckets[target].maxClues : 0;
+		mtx_unlock(&order->lock);
+		if (target < 0) {
+			break;  // Every bucket is filled
+		}
+
+		// Dig down to a random number of clues in the range of the bucket, a puzzle may stop above it
+		double start = secondsNow();
+		int targetClues = minClues + randomInt(maxClues - minClues + 1);
+		generateBoard(board);
+		int clues = rules.cellCount - generateWithStrategy(GENERATION_STRATEGY, board, solution, rules.cellCount - targetClues);
+		int grade = gradePuzzle(board);
+		double seconds = secondsNow() - start;
+
+		mtx_lock(&order->lock);
+		OrderBucket* aimed = &order->buckets[target];
+		aimed->inFlight--;
+		aimed->attempts++;
+		aimed->seconds += seconds;
+		order->produced++;
+		int routed = routePuzzle(order, grade, clues, target);
+		if (routed >= 0) {
+			TRACE_BEGIN("write");
+			aimed->hits += (routed == target);
+			formatBoard(board, text);
+			if (order->checkpointPath[0]) {
+				fprintf(order->output, "%d %s %d %s %llu\n", routed, gradeNames[grade], clues, text, attempt);
+			}
+			else {
+				fprintf(order->output, "%d %s %d %s\n", routed, gradeNames[grade], clues, text);
+			}
+			TRACE_END();
+		}
+		else {
+			order->discarded++;
+		}
+		if (order->checkpointPath[0] && secondsNow() - order->lastCheckpoint >= CHECKPOINT_SECONDS) {
+			writeCheckpoint(order);
+		}
+		mtx_unlock(&order->lock);
+	}
+	return 0;
+}
+
+/* Choose the bucket for the next attempt, with the order lock held. Every unfilled bucket is scored by the
+ * expected time still needed to fill it: the puzzles missing (less those the attempts in flight should bring)
+ * times the time per attempt divided by the yield. Yield and cost start from optimistic guesses so that
+ * every bucket gets tried, and the bucket with the largest expected time gets the thread.
+ *
+ * Returns the index of the bucket, or -1 if every bucket is filled
+ */
+int pickBucket(GenerationOrder* order) {
+	int best = -1;
+	double bestScore = -1.0;
+	double averageCost = 0.0;  // The cost of an attempt over all buckets, the guess for untried buckets
+	int attempts = 0;
+
+	for (int b = 0; b < order->bucketCount; b++) {
+		averageCost += order->buckets[b].seconds;
+		attempts += order->buckets[b].attempts;
+	}
+	averageCost = attempts ? averageCost / attempts : 1.0;
+
+	for (int b = 0; b < order->bucketCount; b++) {
+		OrderBucket* bucket = &order->buckets[b];
+		if (bucket->filled >= bucket->wanted) {
+			continue;
+		}
+		double yield = (bucket->hits + 1.0) / (bucket->attempts + 2.0);  // Never zero, even for a bucket with no hits yet
+		double cost = bucket->attempts ? bucket->seconds / bucket->attempts : averageCost;
+		double missing = bucket->wanted - bucket->filled - bucket->inFlight * yield;
+		double score = (missing > 0.0 ? missing : 0.0) * cost / yield;
+		if (score > bestScore) {
+			bestScore = score;
+			best = b;
+		}
+	}
+	return best;
+}
+
+/* Give a finished puzzle to a bucket, with the order lock held. The bucket it was aimed at is preferred,
+ * then the first unfilled bucket whose grade and clue range it matches.
+ *
+ * Returns the index of the bucket that took the puzzle, or -1 if no bucket wants it
+ */
+int routePuzzle(GenerationOrder* order, int grade, int clues, int preferred) {
+	int chosen = -1;
+
+	for (int b = 0; b < order->bucketCount; b++) {
+		OrderBucket* bucket = &order->buckets[b];
+		if (bucket->filled < bucket->wanted && bucket->grade == grade && clues >= bucket->minClues
+			&& clues <= bucket->maxClues && (chosen < 0 || b == preferred)) {
+			chosen = b;
+		}
+	}
+	if (chosen >= 0) {
+		order->buckets[chosen].filled++;
+	}
+	return chosen;
+}
+
+/* Open the log of an order, <logPath>, with its checkpoint <logPath>.checkpoint.
+ * Without a checkpoint a new log is started. With one, the order is resumed: the checkpoint must be for the
+ * same build and buckets, its counts and random seed are restored, and the puzzles the log received after it
+ * was saved are counted back into their buckets. Those came from attempts the checkpoint counts as not made
+ * yet, so the attempts continue after the last of them. A line cut short by a crash is cut off the log.
+ *
+ * Returns TRUE with order->output set to the log, FALSE (with a message) if the log can't be used
+ */
+int openOrderLog(GenerationOrder* order, const char* logPath) {
+	FILE* checkpoint;
+	FILE* log;
+	long logOffset = 0;
+
+	if (strlen(logPath) + sizeof(".checkpoint") > MAX_PATH_LENGTH) {
+		fprintf(stderr, "The log path is too long\n");
+		return FALSE;
+	}
+	sprintf(order->checkpointPath, "%s.checkpoint", logPath);
+
+	checkpoint = fopen(order->checkpointPath, "r");
+	if (checkpoint == NULL) {
+		// A new order, refuse to append to a log that some other order wrote
+		log = fopen(logPath, "r");
+		if (log != NULL) {
+			fclose(log);
+			fprintf(stderr, "%s exists without a checkpoint, remove it or choose another log\n", logPath);
+			return FALSE;
+		}
+		order->output = fopen(logPath, "wb");
+		if (order->output == NULL) {
+			fprintf(stderr, "Can't create %s\n", logPath);
+			return FALSE;
+		}
+		return writeCheckpoint(order);
+	}
+
+	// Restore the order from the checkpoint, checking that it is the order given on the command line
+	int size, variant, bucketCount;
+	unsigned long long seed, nextAttempt;
+	int produced, discarded;
+	int valid = fscanf(checkpoint, " sudokuPuzzles order checkpoint size %d variant %d seed %llu attempts %llu"
+		" produced %d discarded %d log %ld buckets %d", &size, &variant, &seed, &nextAttempt, &produced, &discarded,
+		&logOffset, &bucketCount) == 8 && size == SIZE && variant == VARIANT && bucketCount == order->bucketCount;
+	for (int b = 0; valid && b < bucketCount; b++) {
+		OrderBucket saved;
+		OrderBucket* bucket = &order->buckets[b];
+		valid = fscanf(checkpoint, "%d %d %d %d %d %d %d %lf", &saved.grade, &saved.minClues, &saved.maxClues,
+			&saved.wanted, &saved.filled, &saved.attempts, &saved.hits, &saved.seconds) == 8
+			&& saved.grade == bucket->grade && saved.minClues == bucket->minClues
+			&& saved.maxClues == bucket->maxClues && saved.wanted == bucket->wanted;
+		bucket->filled = saved.filled;
+		bucket->attempts = saved.attempts;
+		bucket->hits = saved.hits;
+		bucket->seconds = saved.seconds;
+	}
+	fclose(checkpoint);
+	if (!valid) {
+		fprintf(stderr, "%s is not a checkpoint of this order (same build and buckets)\n", order->checkpointPath);
+		return FALSE;
+	}
+	order->seed = seed;
+	order->nextAttempt = nextAttempt;
+	order->produced = produced;
+	order->discarded = discarded;
+
+	log = fopen(logPath, "r+b");
+	if (log == NULL || fseek(log, logOffset, SEEK_SET) != 0) {
+		fprintf(stderr, "Can't reopen %s at offset %ld\n", logPath, logOffset);
+		return FALSE;
+	}
+
+	// Count the puzzles written after the checkpoint back into their buckets
+	char line[GRID_CELLS + 64];
+	long end = logOffset;  // The end of the last complete line
+	int recovered = 0;
+	while (fgets(line, sizeof(line), log) != NULL && strchr(line, '\n') != NULL) {
+		int b, clues;
+		char gradeName[16];
+		unsigned long long attempt;
+		if (sscanf(line, "%d %15s %d %*s %llu", &b, gradeName, &clues, &attempt) != 4 || b < 0
+			|| b >= order->bucketCount || strcmp(gradeName, gradeNames[order->buckets[b].grade]) != 0) {
+			break;  // Not a record of this order, keep only what came before it
+		}
+		if (attempt >= order->nextAttempt) {
+			order->nextAttempt = attempt + 1;
+		}
+		order->buckets[b].filled++;
+		order->produced++;
+		recovered++;
+		end = ftell(log);
+	}
+	if (!truncateFile(log, end) || fseek(log, end, SEEK_SET) != 0) {
+		fprintf(stderr, "Can't cut %s back to its last complete puzzle\n", logPath);
+		fclose(log);
+		return FALSE;
+	}
+	order->output = log;
+
+	int filled = 0;
+	for (int b = 0; b < order->bucketCount; b++) {
+		filled += order->buckets[b].filled;
+	}
+	fprintf(stderr, "Resuming from %s: %d puzzles in the log (%d after the checkpoint), attempt %llu\n",
+		order->checkpointPath, filled, recovered, order->nextAttempt);
+	return writeCheckpoint(order);
+}
+
+/* Save the checkpoint of an order that writes to a log, with the order lock held (or before the workers start).
+ * The log is flushed first so that the checkpoint never points past what the log holds, and the checkpoint is
+ * written to a temporary file that replaces the old one only once complete.
+ *
+ * Returns TRUE if the checkpoint was saved
+ */
+int writeCheckpoint(GenerationOrder* order) {
+	char temporaryPath[MAX_PATH_LENGTH + 4];
+	FILE* checkpoint;
+
+	fflush(order->output);
+	long logOffset = ftell(order->output);
+
+	sprintf(temporaryPath, "%s.tmp", order->checkpointPath);
+	checkpoint = fopen(temporaryPath, "w");
+	if (checkpoint == NULL) {
+		fprintf(stderr, "Can't write the checkpoint %s\n", temporaryPath);
+		return FALSE;
+	}
+	fprintf(checkpoint, "sudokuPuzzles order checkpoint\nsize %d variant %d\nseed %llu\nattempts %llu\n"
+		"produced %d discarded %d\nlog %ld\nbuckets %d\n", SIZE, VARIANT, order->seed, order->nextAttempt,
+		order->produced, order->discarded, logOffset, order->bucketCount);
+	for (int b = 0; b < order->bucketCount; b++) {
+		OrderBucket* bucket = &order->buckets[b];
+		fprintf(checkpoint, "%d %d %d %d %d %d %d %.6f\n", bucket->grade, bucket->minClues, bucket->maxClues,
+			bucket->wanted, bucket->filled, bucket->attempts, bucket->hits, bucket->seconds);
+	}
+	int written = !ferror(checkpoint);
+	written = (fclose(checkpoint) == 0) && written;
+
+#if defined(_WIN32)
+	remove(order->checkpointPath);  // rename() doesn't replace an existing file on Windows
+#endif
+	if (!written || rename(temporaryPath, order->checkpointPath) != 0) {
+		fprintf(stderr, "Can't save the checkpoint %s\n", order->checkpointPath);
+		return FALSE;
+	}
+	order->lastCheckpoint = secondsNow();
+	return TRUE;
+}
+
+/* Cut an open file down to size bytes.
+ * Returns TRUE on success
+ */
+int truncateFile(FILE* file, long size) {
+	fflush(file);
+#if defined(_WIN32)
+	return _chsize_s(_fileno(file), size) == 0;
+#else
+	return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+/* The wall clock time in seconds, for measuring the cost of work done by a thread */
+double secondsNow(void) {
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+#if SEARCH_PROFILE
+/* The histograms of the calling thread, made and registered for searchProfileExport() the first time they are
+ * needed
+ */
+SearchProfile* searchProfile(void) {
+	if (threadProfile == NULL) {
+		int thread = atomic_fetch_add(&profileThreads, 1);
+		threadProfile = thread < MAX_PROFILE_THREADS ? calloc(1, sizeof(SearchProfile)) : NULL;
+		if (threadProfile == NULL) {
+			threadProfile = &unlistedProfile;
+		}
+		else {
+			searchProfiles[thread] = threadProfile;
+		}
+	}
+	return threadProfile;
+}
+
+/* Add up the histograms of every thread and write them to SEARCH_PROFILE_FILE, run when the program exits.
+ * Each histogram is a list indexed by depth, cell or number of moves.
+ */
+void searchProfileExport(void) {
+	static SearchProfile total;
+	int threads = atomic_load(&profileThreads);
+
+	for (int t = 0; t < threads && t < MAX_PROFILE_THREADS; t++) {
+		const long long* from = (const long long*)searchProfiles[t];
+		long long* to = (long long*)&total;
+		for (size_t i = 0; from != NULL && i < sizeof(total) / sizeof(long long); i++) {
+			to[i] += from[i];  // Every field is a count
+		}
+	}
+
+	FILE* output = fopen(SEARCH_PROFILE_FILE, "w");
+	if (output == NULL) {
+		fprintf(stderr, "Can't write the search profile %s\n", SEARCH_PROFILE_FILE);
+		return;
+	}
+	fprintf(output, "{\n\"size\": %d,\n\"variant\": %d,\n\"gridWidth\": %d,\n\"searches\": %lld,\n\"nodes\": %lld,\n",
+		SIZE, VARIANT, GRID_WIDTH, total.searches, total.nodes);
+	writeHistogram(output, "nodesByDepth", total.depthNodes, GRID_CELLS + 1);
+	writeHistogram(output, "nodesByCell", total.cellNodes, GRID_CELLS);
+	writeHistogram(output, "levelsByMoves", total.branching, SIZE + 1);
+	writeHistogram(output, "deadEndsByDepth", total.deadEnds, GRID_CELLS + 1);
+	writeHistogram(output, "solutionsByDepth", total.solutions, GRID_CELLS + 1);
+	fprintf(output, "\"threads\": %d\n}\n", threads);
+	fclose(output);
+	fprintf(stderr, "Search profile of %lld searches, %lld nodes written to %s\n", total.searches, total.nodes,
+		SEARCH_PROFILE_FILE);
+}
+
+/* Write one histogram as a JSON member, leaving out the zeros at its end */
+void writeHistogram(FILE* output, const char* name, const long long* counts, int length) {
+	while (length > 0 && counts[length - 1] == 0) {
+		length--;
+	}
+	fprintf(output, "\"%s\": [", name);
+	for (int i = 0; i < length; i++) {
+		fprintf(output, i ? ", %lld" : "%lld", counts[i]);
+	}
+	fprintf(output, "],\n");
+}
+#endif
+
+#if TRACE_SPANS
+/* The span buffer of the calling thread, made and registered for traceExport() the first time it is needed.
+ * Returns NULL if there is no room for another thread's spans
+ */
+TraceBuffer* traceBuffer(void) {
+	if (threadTrace == NULL) {
+		int thread = atomic_fetch_add(&traceThreads, 1);
+		if (thread >= MAX_TRACE_THREADS) {
+			return NULL;
+		}
+		threadTrace = calloc(1, sizeof(TraceBuffer));
+		if (threadTrace != NULL) {
+			threadTrace->thread = thread;
+		}
+		traceBuffers[thread] = threadTrace;  // Left NULL if out of memory
+	}
+	return threadTrace;
+}
+
+/* Open a span of the calling thread, closed by the matching traceEnd(). name must outlive the program, such as
+ * a string literal. Costs two reads of the clock with the traceEnd(); spans past TRACE_BUFFER_SPANS are dropped.
+ */
+void traceBegin(const char* name) {
+	TraceBuffer* trace = threadTrace != NULL ? threadTrace : traceBuffer();
+	if (trace == NULL) {
+		return;
+	}
+	int span = -1;
+	if (trace->count < TRACE_BUFFER_SPANS) {
+		span = trace->count++;
+		trace->spans[span].name = name;
+		trace->spans[span].end = 0;
+		trace->spans[span].start = TRACE_CLOCK();
+	}
+	else {
+		trace->dropped++;
+	}
+	if (trace->depth < TRACE_DEPTH) {
+		trace->open[trace->depth] = span;
+	}
+	trace->depth++;
+}
+
+/* Close the span of the calling thread opened last */
+void traceEnd(void) {
+	long long now = TRACE_CLOCK();
+	TraceBuffer* trace = threadTrace;
+
+	if (trace == NULL || trace->depth == 0) {
+		return;
+	}
+	trace->depth--;
+	if (trace->depth < TRACE_DEPTH && trace->open[trace->depth] >= 0) {
+		trace->spans[trace->open[trace->depth]].end = now;
+	}
+}
+
+/* Name the calling thread in the trace, name must outlive the program */
+void traceThread(const char* name) {
+	TraceBuffer* trace = traceBuffer();
+	if (trace != NULL) {
+		trace->name = name;
+	}
+}
+
+/* Write every closed span of every thread to TRACE_FILE in the Chrome trace format, run when the program exits */
+void traceExport(void) {
+	double elapsed = secondsNow() - traceStartSeconds;
+	double ticksPerMicrosecond = elapsed > 0.0 ? (TRACE_CLOCK() - traceStartTicks) / (elapsed * 1e6) : 1.0;
+	int threads = atomic_load(&traceThreads);
+	long long spans = 0, dropped = 0;
+	const char* separator = "";
+
+	FILE* output = fopen(TRACE_FILE, "w");
+	if (output == NULL) {
+		fprintf(stderr, "Can't write the trace %s\n", TRACE_FILE);
+		return;
+	}
+	fprintf(output, "{\"traceEvents\":[\n");
+	for (int t = 0; t < threads && t < MAX_TRACE_THREADS; t++) {
+		TraceBuffer* trace = traceBuffers[t];
+		if (trace == NULL) {
+			continue;
+		}
+		if (trace->name != NULL) {
+			fprintf(output, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+				separator, trace->thread, trace->name, trace->thread);
+			separator = ",\n";
+		}
+		for (int i = 0; i < trace->count; i++) {
+			TraceSpan* span = &trace->spans[i];
+			if (span->end == 0) {
+				continue;  // Still open when the program ended
+			}
+			fprintf(output, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", separator,
+				span->name, trace->thread, (span->start - traceStartTicks) / ticksPerMicrosecond,
+				(span->end - span->start) / ticksPerMicrosecond);
+			separator = ",\n";
+			spans++;
+		}
+		dropped += trace->dropped;
+	}
+	fprintf(output, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	fclose(output);
+	fprintf(stderr, "%lld spans of %d threads written to %s, %lld dropped\n", spans, threads, TRACE_FILE, dropped);
+}
+#endif
+
+#if PERF_COUNTERS
+/* Open the event counters of the calling thread as one group, so that a change of phase costs a single read.
+ * The task clock always counts, the hardware events only where the processor and permissions allow
+ * (see /proc/sys/kernel/perf_event_paranoid); those that can't be opened are left out.
+ */
+void perfOpen(void) {
+	static const struct { unsigned int type; unsigned long long config; } events[PERF_EVENTS] = {
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },  // Usually the misses of the last level cache
+	};
+	struct perf_event_attr attributes;
+	int counted = 0;
+
+	memset(&threadPerf, 0, sizeof(threadPerf));
+	threadPerf.leader = -1;
+	for (int e = 0; e < PERF_EVENTS; e++) {
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = events[e].type;
+		attributes.config = events[e].config;
+		attributes.read_format = PERF_FORMAT_GROUP;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		threadPerf.files[e] = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, threadPerf.leader, 0);
+		threadPerf.slots[e] = threadPerf.files[e] >= 0 ? counted++ : -1;
+		if (e == 0 && threadPerf.files[e] < 0) {
+			return;  // Not even the task clock, count nothing
+		}
+		if (e == 0) {
+			threadPerf.leader = threadPerf.files[e];
+		}
+	}
+	perfRead(threadPerf.last);
+}
+
+/* Read the counters of the calling thread */
+void perfRead(long long values[PERF_EVENTS]) {
+	unsigned long long group[PERF_EVENTS + 1] = { 0 };  // The number of counters, then each count
+
+	if (read(threadPerf.leader, group, sizeof(group)) <= 0) {
+		group[0] = 0;
+	}
+	for (int e = 0; e < PERF_EVENTS; e++) {
+		int slot = threadPerf.slots[e];
+		values[e] = slot >= 0 && (unsigned long long)slot < group[0] ? (long long)group[slot + 1] : 0;
+	}
+}
+
+/* Add what has been counted since the last change of phase to the phase running until now */
+void perfSwitch(void) {
+	long long now[PERF_EVENTS];
+	int phase = threadPerf.depth > 0 ? threadPerf.phases[threadPerf.depth - 1] : PHASE_OTHER;
+
+	perfRead(now);
+	for (int e = 0; e < PERF_EVENTS; e++) {
+		threadPerf.counts[phase][e] += now[e] - threadPerf.last[e];
+		threadPerf.last[e] = now[e];
+	}
+}
+
+/* Start counting the events of the calling thread as a phase. Phases nest: the events of a phase begun inside
+ * another, such as the uniqueness checks of the dig, are counted for the inner phase only.
+ */
+void perfBegin(int phase) {
+	if (threadPerf.leader < 0 || threadPerf.depth == PERF_DEPTH) {
+		return;
+	}
+	perfSwitch();
+	memcpy(threadPerf.begun[threadPerf.depth], threadPerf.counts, sizeof(threadPerf.counts));
+	threadPerf.phases[threadPerf.depth++] = phase;
+}
+
+/* End the phase begun last, and add everything counted since it began, split by phase, to into unless NULL */
+void perfEnd(long long into[PHASES][PERF_EVENTS]) {
+	if (threadPerf.leader < 0 || threadPerf.depth == 0) {
+		return;
+	}
+	perfSwitch();
+	threadPerf.depth--;
+	for (int phase = 0; into != NULL && phase < PHASES; phase++) {
+		for (int e = 0; e < PERF_EVENTS; e++) {
+			into[phase][e] += threadPerf.counts[phase][e] - threadPerf.begun[threadPerf.depth][phase][e];
+		}
+	}
+}
+
+/* Add the counts of the calling thread to the totals of the run and close its counters */
+void perfClose(PerfTotals* totals) {
+	if (threadPerf.leader < 0) {
+		return;
+	}
+	perfSwitch();
+	mtx_lock(&totals->lock);
+	for (int e = 0; e < PERF_EVENTS; e++) {
+		for (int phase = 0; phase < PHASES; phase++) {
+			totals->counts[phase][e] += threadPerf.counts[phase][e];
+		}
+		totals->counted[e] += (threadPerf.files[e] >= 0);
+	}
+	mtx_unlock(&totals->lock);
+	for (int e = PERF_EVENTS - 1; e >= 0; e--) {
+		if (threadPerf.files[e] >= 0) {
+			close(threadPerf.files[e]);
+		}
+	}
+	threadPerf.leader = -1;
+}
+
+/* Write the counts of a run by phase, with instructions per cycle and misses per thousand instructions */
+void perfReport(FILE* output, PerfTotals* totals) {
+	if (totals->counted[0] == 0) {
+		fprintf(output, "No event counters, perf_event_open() is not allowed here\n");
+		return;
+	}
+	fprintf(output, "%-7s", "phase");
+	for (int e = 0; e < PERF_EVENTS; e++) {
+		fprintf(output, " %15s", perfEventNames[e]);
+	}
+	fprintf(output, "     IPC  branch/kI  L1D/kI  LLC/kI\n");
+	for (int phase = 0; phase < PHASES; phase++) {
+		const long long* counts = totals->counts[phase];
+		double kiloInstructions = counts[2] / 1000.0;
+		fprintf(output, "%-7s", phaseNames[phase]);
+		for (int e = 0; e < PERF_EVENTS; e++) {
+			if (totals->counted[e] > 0) {
+				fprintf(output, " %15lld", counts[e]);
+			}
+			else {
+				fprintf(output, " %15s", "n/a");
+			}
+		}
+		if (counts[1] > 0 && kiloInstructions > 0.0) {
+			fprintf(output, " %7.2f %10.2f %7.2f %7.2f", (double)counts[2] / counts[1], counts[3] / kiloInstructions,
+				counts[4] / kiloInstructions, counts[5] / kiloInstructions);
+		}
+		fputc('\n', output);
+	}
+}
+#endif
+
+/* Make puzzles with a pipeline of stages, each one running on its own group of threads:
+ *     grid filling -> hole digging -> grading -> writing (duplicate removal and output, one thread)
+ * Arguments: <count> [gridThreads digThreads gradeThreads [seed]]
+ * The stages are joined by bounded lock-free queues, and the pipeline holds a fixed pool of PIPELINE_ITEMS
+ * puzzles: a stage that falls behind fills its input queue and holds back the stages before it, and once
+ * every item is in flight the grid stage waits for the writer to hand one back.
+ * Each puzzle's random numbers come from the seed and its index and the writer takes the puzzles in index
+ * order, so a given seed writes the same bytes for any thread counts.
+ * Puzzles are written to stdout as: index grade clues board, and the throughput of each stage to stderr.
+ *
+ * Returns 0 when done, 1 for bad arguments
+ */
+
+int runPipeline(int argc, char* argv[]) {
+	static Pipeline pipeline;
+	int gridThreads = argc > 1 ? atoi(argv[1]) : 1;
+	int digThreads = argc > 2 ? atoi(argv[2]) : 2;
+	int gradeThreads = argc > 3 ? atoi(argv[3]) : 1;
+
+	if (argc < 1 || atoi(argv[0]) < 1 || gridThreads < 1 || digThreads < 1 || gradeThreads < 1
+		|| gridThreads + digThreads + gradeThreads + 2 > MAX_THREADS) {
+		fprintf(stderr, "Usage: pipeline <count> [gridThreads digThreads gradeThreads [seed]]\n");
+		return 1;
+	}
+	if (VARIANT == KILLER) {
+		fprintf(stderr, "Pipelines of KILLER puzzles are not supported, the board text does not hold the cages.\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	pipeline.count = atoi(argv[0]);
+	pipeline.seed = argc > 4 ? strtoull(argv[4], NULL, 0) : randomState;
+	pipeline.shardId = 0;
+	pipeline.shardCount = 1;
+	pipeline.output = stdout;
+	return executePipeline(&pipeline, gridThreads, digThreads, gradeThreads);
+}
+
+/* Run a pipeline set up with its count, seed, shard and output, see runPipeline().
+ * count is the number of puzzles this pipeline makes: the puzzles numbered shardId + k * shardCount for
+ * k = 0 ... count - 1.
+ *
+ * Returns 0 when done, 1 if out of memory
+ */
+int executePipeline(Pipeline* pipeline, int gridThreads, int digThreads, int gradeThreads) {
+	thrd_t threads[MAX_THREADS];
+	int threadCount = 0;
+
+	atomic_init(&pipeline->nextIndex, 0);
+	pipeline->duplicates = 0;
+	pipeline->written = 0;
+	for (pipeline->seenSize = 1; pipeline->seenSize < 2 * pipeline->count; pipeline->seenSize *= 2);
+	pipeline->seen = calloc(pipeline->seenSize, sizeof(unsigned long long));
+	if (pipeline->seen == NULL) {
+		fprintf(stderr, "Not enough memory for %d puzzles\n", pipeline->count);
+		return 1;
+	}
+
+	// The free items start out holding the whole pool
+	queueInit(&pipeline->queues[0], PIPELINE_ITEMS);
+	for (int i = 0; i < PIPELINE_ITEMS; i++) {
+		queueTryPush(&pipeline->queues[0], &pipeline->items[i]);
+	}
+	for (int q = 1; q < PIPELINE_STAGES - 1; q++) {
+		queueInit(&pipeline->queues[q], PIPELINE_QUEUE_SIZE);
+	}
+	reorderInit(&pipeline->ring);
+#if PERF_COUNTERS
+	memset(&pipeline->perf, 0, sizeof(pipeline->perf));
+	mtx_init(&pipeline->perf.lock, mtx_plain);
+	pipeline->perfLog = fopen(PERF_LOG, "w");
+	if (pipeline->perfLog != NULL) {
+		fprintf(pipeline->perfLog, "puzzle,phase");
+		for (int e = 0; e < PERF_EVENTS; e++) {
+			fprintf(pipeline->perfLog, ",%s", perfEventNames[e]);
+		}
+		fputc('\n', pipeline->perfLog);
+	}
+#endif
+
+	const char* names[PIPELINE_STAGES] = { "grid", "dig", "grade", "write" };
+	int (*process[PIPELINE_STAGES])(Pipeline*, PipelineItem*) = { stageFillGrid, stageDig, stageGrade, stageWrite };
+	int threadsPerStage[PIPELINE_STAGES] = { gridThreads, digThreads, gradeThreads, 1 };
+	for (int s = 0; s < PIPELINE_STAGES; s++) {
+		PipelineStage* stage = &pipeline->stages[s];
+		stage->pipeline = pipeline;
+		stage->name = names[s];
+		stage->threads = threadsPerStage[s];
+		stage->process = process[s];
+		stage->input = s < PIPELINE_STAGES - 1 ? &pipeline->queues[s] : NULL;
+		stage->output = s < PIPELINE_STAGES - 2 ? &pipeline->queues[s + 1] : s == PIPELINE_STAGES - 1 ? &pipeline->queues[0] : NULL;
+		atomic_init(&stage->running, stage->threads);
+		atomic_init(&stage->items, 0);
+		atomic_init(&stage->busyNanoseconds, 0);
+		atomic_init(&stage->waitNanoseconds, 0);
+	}
+
+	double start = secondsNow();
+	for (int s = 0; s < PIPELINE_STAGES; s++) {
+		for (int t = 0; t < pipeline->stages[s].threads; t++) {
+			thrd_create(&threads[threadCount++], s < PIPELINE_STAGES - 1 ? pipelineWorker : pipelineWriter, &pipeline->stages[s]);
+		}
+	}
+	for (int t = 0; t < threadCount; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	double elapsed = secondsNow() - start;
+
+	for (int s = 0; s < PIPELINE_STAGES && !pipeline->quiet; s++) {
+		if (s == 0) {
+			fprintf(stderr, "%d puzzles in %.3f s, %d duplicates dropped\n", pipeline->count, elapsed, pipeline->duplicates);
+		}
+		PipelineStage* stage = &pipeline->stages[s];
+		int items = atomic_load(&stage->items);
+		double busy = atomic_load(&stage->busyNanoseconds) * 1e-9;
+		fprintf(stderr, "stage %-6s %2d threads: %d items, %.1f items/s per thread, busy %.3f s, waiting %.3f s\n",
+			stage->name, stage->threads, items, busy > 0.0 ? items / busy : 0.0, busy,
+			atomic_load(&stage->waitNanoseconds) * 1e-9);
+	}
+
+#if PERF_COUNTERS
+	if (!pipeline->quiet) {
+		perfReport(stderr, &pipeline->perf);
+	}
+	if (pipeline->perfLog != NULL) {
+		fclose(pipeline->perfLog);
+	}
+	mtx_destroy(&pipeline->perf.lock);
+#endif
+
+	for (int q = 0; q < PIPELINE_STAGES - 1; q++) {
+		free(pipeline->queues[q].slots);
+	}
+	free(pipeline->seen);
+	return 0;
+}
+
+/* The work loop of one thread of a pipeline stage before the writer, arg is the PipelineStage.
+ * Items are taken from the input queue until it is closed and empty (the grid stage instead stops once every
+ * grid index is taken). The last thread of a stage to finish closes its output queue.
+ */
+int pipelineWorker(void* arg) {
+	PipelineStage* stage = (PipelineStage*)arg;
+	Pipeline* pipeline = stage->pipeline;
+	int done = FALSE;
+
+	buildRules(VARIANT);
+	TRACE_THREAD(stage->name);
+#if PERF_COUNTERS
+	perfOpen();
+#endif
+
+	while (!done) {
+		void* item;
+		double waitStart = secondsNow();
+
+		// Wait for an item, the input is finished once it is closed and still empty
+		while (!queueTryPop(stage->input, &item)) {
+			if (atomic_load(&stage->input->closed) && !queueTryPop(stage->input, &item)) {
+				item = NULL;
+				break;
+			}
+			thrd_yield();
+		}
+		double busyStart = secondsNow();
+		atomic_fetch_add(&stage->waitNanoseconds, (long long)((busyStart - waitStart) * 1e9));
+		if (item == NULL) {
+			break;
+		}
+
+		// The thread's random numbers continue from where the previous stage left this puzzle's
+		randomState = ((PipelineItem*)item)->random;
+		PERF_BEGIN(PHASE_GRID + (int)(stage - pipeline->stages));
+		int keep = stage->process(pipeline, (PipelineItem*)item);
+		PERF_END(((PipelineItem*)item)->perf);
+		((PipelineItem*)item)->random = randomState;
+		if (keep < 0) {
+			keep = FALSE;  // The grid stage ran out of work
+			done = TRUE;
+		}
+		else {
+			atomic_fetch_add(&stage->items, 1);
+		}
+		double busyEnd = secondsNow();
+		atomic_fetch_add(&stage->busyNanoseconds, (long long)((busyEnd - busyStart) * 1e9));
+
+		// Pass the item on, a dropped item goes back to the free items which always have room for it
+		if (keep && stage->output == NULL) {
+			while (!reorderTryPush(&pipeline->ring, ((PipelineItem*)item)->index, item)) {
+				thrd_yield();
+			}
+		}
+		else {
+			BoundedQueue* next = keep ? stage->output : &pipeline->queues[0];
+			while (!queueTryPush(next, item)) {
+				thrd_yield();
+			}
+		}
+		atomic_fetch_add(&stage->waitNanoseconds, (long long)((secondsNow() - busyEnd) * 1e9));
+	}
+
+#if PERF_COUNTERS
+	perfClose(&pipeline->perf);
+#endif
+	if (atomic_fetch_sub(&stage->running, 1) == 1 && stage->output != NULL) {
+		atomic_store(&stage->output->closed, TRUE);
+	}
+	return 0;
+}
+
+/* The work loop of the writer, the last stage of a pipeline, arg is its PipelineStage.
+ * Takes the puzzles from the reorder ring in index order until all of them are written, then returns each
+ * one to the free items.
+ */
+int pipelineWriter(void* arg) {
+	PipelineStage* stage = (PipelineStage*)arg;
+	Pipeline* pipeline = stage->pipeline;
+
+	buildRules(VARIANT);
+	TRACE_THREAD(stage->name);
+#if PERF_COUNTERS
+	perfOpen();
+#endif
+
+	while (pipeline->ring.nextIndex < (size_t)pipeline->count) {
+		void* item;
+		double waitStart = secondsNow();
+		while (!reorderTryPop(&pipeline->ring, &item)) {
+			thrd_yield();
+		}
+		double busyStart = secondsNow();
+		atomic_fetch_add(&stage->waitNanoseconds, (long long)((busyStart - waitStart) * 1e9));
+
+		PERF_BEGIN(PHASE_WRITE);
+		TRACE_BEGIN("write");
+		int written = stage->process(pipeline, (PipelineItem*)item);
+		TRACE_END();
+		PERF_END(((PipelineItem*)item)->perf);
+		atomic_fetch_add(&stage->items, written);
+		atomic_fetch_add(&stage->busyNanoseconds, (long long)((secondsNow() - busyStart) * 1e9));
+#if PERF_COUNTERS
+		// One line per phase of each puzzle written
+		for (int phase = PHASE_GRID; written && pipeline->perfLog != NULL && phase < PHASES; phase++) {
+			fprintf(pipeline->perfLog, "%d,%s", pipeline->shardId + ((PipelineItem*)item)->index * pipeline->shardCount,
+				phaseNames[phase]);
+			for (int e = 0; e < PERF_EVENTS; e++) {
+				fprintf(pipeline->perfLog, ",%lld", ((PipelineItem*)item)->perf[phase][e]);
+			}
+			fputc('\n', pipeline->perfLog);
+		}
+#endif
+
+		while (!queueTryPush(stage->output, item)) {
+			thrd_yield();
+		}
+	}
+#if PERF_COUNTERS
+	perfClose(&pipeline->perf);
+#endif
+	return 0;
+}
+
+/* Pipeline stage: fill a random solution board, returns -1 once every grid has been started.
+ * Starts the puzzle's random numbers from its index so that no puzzle depends on which thread made it.
+ */
+int stageFillGrid(Pipeline* pipeline, PipelineItem* item) {
+	item->index = atomic_fetch_add(&pipeline->nextIndex, 1);
+	if (item->index >= pipeline->count) {
+		return -1;
+	}
+#if PERF_COUNTERS
+	memset(item->perf, 0, sizeof(item->perf));  // Counted from here on, the rest of this phase included
+#endif
+	seedRandom(streamSeed(pipeline->seed, (unsigned long long)pipeline->shardId
+		+ (unsigned long long)item->index * (unsigned long long)pipeline->shardCount));
+	generateBoard(item->solution);
+	return TRUE;
+}
+
+/* Pipeline stage: dig a puzzle out of the solution board with the GENERATION_STRATEGY */
+int stageDig(Pipeline* pipeline, PipelineItem* item) {
+	(void)pipeline;
+	duplicateBoard(item->solution, item->puzzle);
+	item->clues = rules.cellCount - generateWithStrategy(GENERATION_STRATEGY, item->puzzle, item->solution, MAX_EMPTY);
+	return TRUE;
+}
+
+/* Pipeline stage: grade the puzzle */
+int stageGrade(Pipeline* pipeline, PipelineItem* item) {
+	(void)pipeline;
+	item->grade = gradePuzzle(item->puzzle);
+	return TRUE;
+}
+
+/* Pipeline stage: write the puzzle to stdout unless the same puzzle has already been written, found by the
+ * hash of its text. Runs on the single writer thread in index order, so the table of hashes needs no locking
+ * and the same duplicates are dropped on every run.
+ *
+ * Returns TRUE if the puzzle was written
+ */
+int stageWrite(Pipeline* pipeline, PipelineItem* item) {
+	char text[GRID_CELLS + 1];
+	formatBoard(item->puzzle, text);
+	unsigned long long hash = hashText(text) | 1;  // 0 marks an empty slot of the table
+
+	int slot = (int)(hash & (pipeline->seenSize - 1));
+	while (pipeline->seen[slot] != 0) {
+		if (pipeline->seen[slot] == hash) {
+			pipeline->duplicates++;
+			return FALSE;
+		}
+		slot = (slot + 1) & (pipeline->seenSize - 1);
+	}
+	pipeline->seen[slot] = hash;
+
+	if (pipeline->shared != NULL) {
+		sharedPublish(pipeline->shared, pipeline->shardId + item->index * pipeline->shardCount, item->grade,
+			item->clues, item->puzzle);
+	}
+	else {
+		fprintf(pipeline->output, "%d %s %d %s\n", pipeline->shardId + item->index * pipeline->shardCount,
+			gradeNames[item->grade], item->clues, text);
+	}
+	pipeline->written++;
+	return TRUE;
+}
+
+/* Set up an empty queue, capacity must be a power of 2 */
+void queueInit(BoundedQueue* queue, size_t capacity) {
+	queue->slots = malloc(capacity * sizeof(QueueSlot));
+	queue->mask = capacity - 1;
+	for (size_t i = 0; i < capacity; i++) {
+		atomic_init(&queue->slots[i].sequence, i);
+		queue->slots[i].item = NULL;
+	}
+	atomic_init(&queue->writePosition, 0);
+	atomic_init(&queue->readPosition, 0);
+	atomic_init(&queue->closed, FALSE);
+}
+
+/* Add an item to a queue without waiting. Returns FALSE if the queue is full */
+int queueTryPush(BoundedQueue* queue, void* item) {
+	size_t position = atomic_load_explicit(&queue->writePosition, memory_order_relaxed);
+
+	for (;;) {
+		QueueSlot* slot = &queue->slots[position & queue->mask];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == position) {
+			// The slot is free at this position, claim the position unless another producer got there first
+			if (atomic_compare_exchange_weak_explicit(&queue->writePosition, &position, position + 1,
+				memory_order_relaxed, memory_order_relaxed)) {
+				slot->item = item;
+				atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+				return TRUE;
+			}
+		}
+		else if (sequence < position) {
+			return FALSE;  // The slot still holds the item from one lap ago, the queue is full
+		}
+		else {
+			position = atomic_load_explicit(&queue->writePosition, memory_order_relaxed);
+		}
+	}
+}
+
+/* Take the oldest item from a queue without waiting. Returns FALSE if the queue is empty */
+int queueTryPop(BoundedQueue* queue, void** item) {
+	size_t position = atomic_load_explicit(&queue->readPosition, memory_order_relaxed);
+
+	for (;;) {
+		QueueSlot* slot = &queue->slots[position & queue->mask];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if (sequence == position + 1) {
+			if (atomic_compare_exchange_weak_explicit(&queue->readPosition, &position, position + 1,
+				memory_order_relaxed, memory_order_relaxed)) {
+				*item = slot->item;
+				// Free the slot for the producer one lap ahead
+				atomic_store_explicit(&slot->sequence, position + queue->mask + 1, memory_order_release);
+				return TRUE;
+			}
+		}
+		else if (sequence < position + 1) {
+			return FALSE;  // Nothing written at this position yet
+		}
+		else {
+			position = atomic_load_explicit(&queue->readPosition, memory_order_relaxed);
+		}
+	}
+}
+
+/* Set up an empty reorder ring waiting for index 0 */
+void reorderInit(ReorderRing* ring) {
+	for (size_t i = 0; i < REORDER_WINDOW; i++) {
+		atomic_init(&ring->slots[i].sequence, i);
+		ring->slots[i].item = NULL;
+	}
+	ring->nextIndex = 0;
+}
+
+/* Put the puzzle with the given index into the reorder ring without waiting.
+ * Returns FALSE if its slot still holds the puzzle one window earlier. That can't last: at most PIPELINE_ITEMS
+ * puzzles are in flight, so the writer is never waiting on an index a whole window back.
+ */
+int reorderTryPush(ReorderRing* ring, size_t index, void* item) {
+	ReorderSlot* slot = &ring->slots[index % REORDER_WINDOW];
+
+	if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != index) {
+		return FALSE;
+	}
+	slot->item = item;
+	atomic_store_explicit(&slot->sequence, index + 1, memory_order_release);
+	return TRUE;
+}
+
+/* Take the puzzle with the next index from the reorder ring without waiting, writer thread only.
+ * Returns FALSE if that puzzle hasn't arrived yet, even when later ones have
+ */
+int reorderTryPop(ReorderRing* ring, void** item) {
+	ReorderSlot* slot = &ring->slots[ring->nextIndex % REORDER_WINDOW];
+
+	if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != ring->nextIndex + 1) {
+		return FALSE;
+	}
+	*item = slot->item;
+	// Free the slot for the index one window ahead
+	atomic_store_explicit(&slot->sequence, ring->nextIndex + REORDER_WINDOW, memory_order_release);
+	ring->nextIndex++;
+	return TRUE;
+}
+
+/* Hash a line of text (64 bit FNV-1a) */
+unsigned long long hashText(const char* text) {
+	unsigned long long hash = 0xCBF29CE484222325ULL;
+
+	while (*text) {
+		hash = (hash ^ (unsigned char)*text++) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+/* Make puzzles one after another and report what each cost to make.
+ * Arguments: <count> [seed], puzzle i is made from streamSeed(seed, i) like puzzle i of a pipeline.
+ * Each puzzle is written to stdout as a line of JSON with its grade and clues, the cells tried while filling
+ * its solution board, the uniqueness checks of its GENERATION_STRATEGY with their search nodes, the removals
+ * accepted and rejected, and the checks and nodes by the number of empty cells checked, as
+ * [empty cells, checks, nodes] triples. The distributions of these over the batch are written to stderr.
+ *
+ * Returns 0 when done, 1 on bad arguments
+ */
+int runTelemetry(int argc, char* argv[]) {
+	if (argc < 1 || atoi(argv[0]) < 1) {
+		fprintf(stderr, "Usage: telemetry <count> [seed]\n");
+		return 1;
+	}
+	if (VARIANT == KILLER) {
+		fprintf(stderr, "Telemetry of KILLER puzzles is not supported, the cages are made by generateKillerPuzzle().\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	int count = atoi(argv[0]);
+	unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 0) : randomState;
+
+	// One column per puzzle of each measure, for the distributions
+	enum { CLUES, FILL_NODES, CHECKS, CHECK_NODES, ACCEPTED, REJECTED, MICROSECONDS, MEASURES };
+	const char* measureNames[MEASURES] = { "clues", "fillNodes", "checks", "checkNodes", "accepted", "rejected",
+		"microseconds" };
+	long long* measures = malloc((size_t)MEASURES * count * sizeof(long long));
+	static long long emptyChecks[GRID_CELLS + 1];
+	static long long emptyNodes[GRID_CELLS + 1];
+	int grades[GRADES] = { 0 };
+	if (measures == NULL) {
+		fprintf(stderr, "Not enough memory for %d puzzles\n", count);
+		return 1;
+	}
+
+	int solution[GRID_WIDTH][GRID_WIDTH];
+	int puzzle[GRID_WIDTH][GRID_WIDTH];
+	for (int i = 0; i < count; i++) {
+		memset(&generationStats, 0, sizeof(generationStats));
+		double start = secondsNow();
+
+		seedRandom(streamSeed(seed, (unsigned long long)i));
+		generateBoard(solution);
+		duplicateBoard(solution, puzzle);
+		int clues = rules.cellCount - generateWithStrategy(GENERATION_STRATEGY, puzzle, solution, MAX_EMPTY);
+		double seconds = secondsNow() - start;  // Grading isn't part of making the puzzle
+		int grade = gradePuzzle(puzzle);
+		grades[grade]++;
+
+		GenerationStats* stats = &generationStats;
+		long long values[MEASURES] = { clues, stats->fillNodes, stats->checks, stats->checkNodes, stats->accepted,
+			stats->rejected, (long long)(seconds * 1e6) };
+		for (int m = 0; m < MEASURES; m++) {
+			measures[(size_t)m * count + i] = values[m];
+		}
+
+		printf("{\"index\":%d,\"grade\":\"%s\",\"clues\":%d,\"fillNodes\":%lld,\"fillRestarts\":%d,"
+			"\"checks\":%d,\"checkNodes\":%lld,\"accepted\":%d,\"rejected\":%d,\"microseconds\":%lld,\"byEmpty\":[",
+			i, gradeNames[grade], clues, stats->fillNodes, stats->fillRestarts, stats->checks, stats->checkNodes,
+			stats->accepted, stats->rejected, values[MICROSECONDS]);
+		int first = TRUE;
+		for (int empty = 0; empty <= GRID_CELLS; empty++) {
+			if (stats->emptyChecks[empty] > 0) {
+				printf("%s[%d,%d,%lld]", first ? "" : ",", empty, stats->emptyChecks[empty], stats->emptyNodes[empty]);
+				first = FALSE;
+				emptyChecks[empty] += stats->emptyChecks[empty];
+				emptyNodes[empty] += stats->emptyNodes[empty];
+			}
+		}
+		printf("]}\n");
+	}
+
+	// The distributions over the batch
+	fprintf(stderr, "%d puzzles, seed %llu, strategy %d\n", count, seed, GENERATION_STRATEGY);
+	fprintf(stderr, "%-14s %12s %12s %12s %12s %12s %14s\n", "", "min", "median", "p90", "p99", "max", "mean");
+	for (int m = 0; m < MEASURES; m++) {
+		printDistribution(measureNames[m], &measures[(size_t)m * count], count);
+	}
+	for (int g = 0; g < GRADES; g++) {
+		fprintf(stderr, "%s %d%s", gradeNames[g], grades[g], g + 1 < GRADES ? ", " : "\n");
+	}
+	fprintf(stderr, "%-12s %12s %14s\n", "empty cells", "checks", "nodes/check");
+	for (int empty = 0; empty <= GRID_CELLS; empty++) {
+		if (emptyChecks[empty] > 0) {
+			fprintf(stderr, "%-12d %12lld %14.1f\n", empty, emptyChecks[empty], (double)emptyNodes[empty] / emptyChecks[empty]);
+		}
+	}
+
+	free(measures);
+	return 0;
+}
+
+/* Order long longs for qsort() */
+int compareLongs(const void* a, const void* b) {
+	long long first = *(const long long*)a;
+	long long second = *(const long long*)b;
+	return (first > second) - (first < second);
+}
+
+/* Print a line of the minimum, percentiles, maximum and mean of count values to stderr, sorting the values */
+void printDistribution(const char* name, long long* values, int count) {
+	double sum = 0;
+
+	qsort(values, count, sizeof(long long), compareLongs);
+	for (int i = 0; i < count; i++) {
+		sum += (double)values[i];
+	}
+	fprintf(stderr, "%-14s %12lld %12lld %12lld %12lld %12lld %14.1f\n", name, values[0], values[count / 2],
+		values[(int)(0.9 * (count - 1))], values[(int)(0.99 * (count - 1))], values[count - 1], sum / count);
+}
+
+/* The boards of the microbenchmarks, made by benchSetup() */
+int benchBoards[BENCH_BOARDS][GRID_WIDTH][GRID_WIDTH];
+char benchTexts[BENCH_BOARDS][GRID_CELLS + 1];
+int benchCells[BENCH_BOARDS * GRID_CELLS];  // The empty cells of every board, numbered board * GRID_CELLS + cell
+int benchCellCount;
+int benchCopy[GRID_WIDTH][GRID_WIDTH];      // Where duplicateBoard() and parseBoard() write
+volatile long long benchSink;                // Takes the result of every benchmark so none is optimized away
+
+BenchMetric benchMetrics[MAX_BENCH_METRICS];
+int benchMetricCount;
+
+const BenchKernel benchKernels[] = {
+	{ "candidateMask", "one empty cell", benchCandidateMask },
+	{ "permittedValue", "one empty cell", benchPermittedValue },
+	{ "nextEmpty", "one board", benchNextEmpty },
+	{ "chooseBranch", "one board", benchChooseBranch },
+	{ "randomInt", "one integer", benchRandomInt },
+	{ "shuffleValues", "all the active cells", benchShuffle },
+	{ "duplicateBoard", "one board", benchDuplicateBoard },
+	{ "formatBoard", "one board", benchFormatBoard },
+	{ "parseBoard", "one board", benchParseBoard },
+};
+#define BENCH_KERNELS ((int)(sizeof(benchKernels) / sizeof(benchKernels[0])))
+
+/* Time the kernels of the solver one at a time and the making of whole puzzles, and compare the results with
+ * a baseline. Arguments: [-save <file>] [-compare <file>] [benchmark...] where a benchmark is a kernel, generate
+ * or pipeline, every one of them if none is named. The SIZE is the one the program was built with, so each
+ * size is measured by its own build (e.g. -DSIZE=16).
+ *
+ * The kernels work on BENCH_BOARDS random solution boards with about half of their cells emptied. A warmup
+ * doubles the operations until they take BENCH_SAMPLE_SECONDS, then BENCH_SAMPLES samples of that many
+ * operations are timed, and the median is the metric of the kernel in ns per operation.
+ * generate makes BENCH_PUZZLES puzzles on one thread and solves each of them, and pipeline makes
+ * BENCH_PIPELINE_PUZZLES with BENCH_GRID_THREADS, BENCH_DIG_THREADS and BENCH_GRADE_THREADS. The seeds and
+ * thread counts are fixed so the results of two builds on one machine can be compared.
+ *
+ * -save writes the metrics to a file, one "name value tolerance" line each under a header line, which can be
+ * used as the baseline as it is or with its tolerances (in percent) edited. -compare reads such a baseline and
+ * checks every metric it has that was measured again: a throughput may not drop, nor a time rise, by more
+ * than its tolerance. With no benchmarks named, a metric of the baseline that this run is missing fails too.
+ *
+ * Returns 0 when done, 1 on bad arguments or a baseline of another build, 2 if a metric regressed
+ */
+int runBench(int argc, char* argv[]) {
+	const char* savePath = NULL;
+	const char* comparePath = NULL;
+	const char* endToEnd[] = { "generate", "pipeline" };
+	int named = 0;  // The benchmarks named, taken from the start of argv
+
+	for (int i = 0; i < argc; i++) {
+		if ((strcmp(argv[i], "-save") == 0 || strcmp(argv[i], "-compare") == 0) && i + 1 < argc) {
+			*(argv[i][1] == 's' ? &savePath : &comparePath) = argv[i + 1];
+			i++;
+			continue;
+		}
+		int known = (strcmp(argv[i], endToEnd[0]) == 0 || strcmp(argv[i], endToEnd[1]) == 0);
+		for (int k = 0; k < BENCH_KERNELS; k++) {
+			known |= (strcmp(argv[i], benchKernels[k].name) == 0);
+		}
+		if (!known) {
+			fprintf(stderr, "Usage: bench [-save <file>] [-compare <file>] [benchmark...], the benchmarks are");
+			for (int k = 0; k < BENCH_KERNELS; k++) {
+				fprintf(stderr, " %s", benchKernels[k].name);
+			}
+			fprintf(stderr, " %s %s\n", endToEnd[0], endToEnd[1]);
+			return 1;
+		}
+		argv[named++] = argv[i];
+	}
+	if (!buildRules(VARIANT == KILLER ? CLASSIC : VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+	benchSetup();
+	benchMetricCount = 0;
+
+	printf("SIZE %d, %d boards with %d empty cells, %d samples of %.0f ms\n", SIZE, BENCH_BOARDS, benchCellCount,
+		BENCH_SAMPLES, BENCH_SAMPLE_SECONDS * 1e3);
+	printf("%-16s %12s %10s %10s %10s %10s  %s\n", "kernel", "ops/sample", "min ns", "median ns", "mean ns",
+		"stddev ns", "operation");
+	for (int k = 0; k < BENCH_KERNELS; k++) {
+		if (benchChosen(benchKernels[k].name, named, argv)) {
+			benchKernel(&benchKernels[k]);
+		}
+	}
+	if (benchChosen(endToEnd[0], named, argv)) {
+		benchGeneration();
+	}
+	if (benchChosen(endToEnd[1], named, argv) && VARIANT != KILLER) {
+		benchPipeline();
+	}
+
+	if (savePath != NULL) {
+		FILE* save = fopen(savePath, "w");
+		if (save == NULL) {
+			fprintf(stderr, "Can't write the results to %s\n", savePath);
+			return 1;
+		}
+		fprintf(save, BENCH_HEADER "\n", SIZE, VARIANT, BENCH_SEED, BENCH_GRID_THREADS, BENCH_DIG_THREADS,
+			BENCH_GRADE_THREADS);
+		for (int m = 0; m < benchMetricCount; m++) {
+			fprintf(save, "%s %.6g %g\n", benchMetrics[m].name, benchMetrics[m].value, benchMetrics[m].tolerance);
+		}
+		fclose(save);
+	}
+	return comparePath != NULL ? benchCompare(comparePath, named == 0) : 0;
+}
+
+/* Check whether a benchmark is to be run: it is one of the named ones, or none are named */
+int benchChosen(const char* name, int named, char* names[]) {
+	int chosen = (named == 0);
+	for (int i = 0; i < named; i++) {
+		chosen |= (strcmp(names[i], name) == 0);
+	}
+	return chosen;
+}
+
+/* Add a result to the metrics of the run and print it. higherIsBetter is TRUE for a throughput and FALSE for
+ * a time, tolerance is the change in percent the saved baseline allows by default.
+ */
+void benchRecord(const char* name, double value, int higherIsBetter, double tolerance) {
+	if (benchMetricCount < MAX_BENCH_METRICS) {
+		BenchMetric* metric = &benchMetrics[benchMetricCount++];
+		snprintf(metric->name, sizeof(metric->name), "%s", name);
+		metric->value = value;
+		metric->higherIsBetter = higherIsBetter;
+		metric->tolerance = tolerance;
+	}
+}
+
+/* Time one kernel: warm it up, time BENCH_SAMPLES samples and print the distribution of their ns per operation */
+void benchKernel(const BenchKernel* kernel) {
+	// Warm up the caches and the branch predictors while finding the operations that fill a sample
+	long long operations = 1;
+	for (;;) {
+		double start = secondsNow();
+		benchSink += kernel->run(operations);
+		if (secondsNow() - start >= BENCH_SAMPLE_SECONDS) {
+			break;
+		}
+		operations *= 2;
+	}
+
+	double samples[BENCH_SAMPLES];
+	double mean = 0;
+	double variance = 0;
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		double start = secondsNow();
+		benchSink += kernel->run(operations);
+		samples[i] = (secondsNow() - start) * 1e9 / operations;
+		mean += samples[i] / BENCH_SAMPLES;
+	}
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		variance += (samples[i] - mean) * (samples[i] - mean) / (BENCH_SAMPLES - 1);
+	}
+	qsort(samples, BENCH_SAMPLES, sizeof(double), compareDoubles);
+	printf("%-16s %12lld %10.2f %10.2f %10.2f %10.2f  %s\n", kernel->name, operations, samples[0],
+		samples[BENCH_SAMPLES / 2], mean, sqrt(variance), kernel->operation);
+	benchRecord(kernel->name, samples[BENCH_SAMPLES / 2], FALSE, BENCH_KERNEL_TOLERANCE);
+}
+
+/* Make BENCH_PUZZLES puzzles one after another on this thread, puzzle i from streamSeed(BENCH_SEED, i), then
+ * solve each of them BENCH_SOLVE_REPEATS times. Records the puzzles made per second and the percentiles of the
+ * time to make a puzzle and to solve one.
+ */
+void benchGeneration(void) {
+	static int puzzles[BENCH_PUZZLES][GRID_WIDTH][GRID_WIDTH];
+	int solution[GRID_WIDTH][GRID_WIDTH];
+	double makeTimes[BENCH_PUZZLES];
+	double solveTimes[BENCH_PUZZLES];
+	double total = 0;
+
+	for (int i = 0; i < BENCH_PUZZLES; i++) {
+		double start = secondsNow();
+		seedRandom(streamSeed(BENCH_SEED, (unsigned long long)i));
+		generateBoard(solution);
+		duplicateBoard(solution, puzzles[i]);
+		generateWithStrategy(GENERATION_STRATEGY, puzzles[i], solution, MAX_EMPTY);
+		makeTimes[i] = (secondsNow() - start) * 1e6;
+		total += makeTimes[i] * 1e-6;
+	}
+	for (int i = 0; i < BENCH_PUZZLES; i++) {
+		double start = secondsNow();
+		for (int r = 0; r < BENCH_SOLVE_REPEATS; r++) {
+			benchSink += countSolutions(puzzles[i], solution, 2);
+		}
+		solveTimes[i] = (secondsNow() - start) * 1e6 / BENCH_SOLVE_REPEATS;
+	}
+	qsort(makeTimes, BENCH_PUZZLES, sizeof(double), compareDoubles);
+	qsort(solveTimes, BENCH_PUZZLES, sizeof(double), compareDoubles);
+
+	printf("\n%d puzzles made on one thread from seed %d, each solved %d times\n", BENCH_PUZZLES, BENCH_SEED,
+		BENCH_SOLVE_REPEATS);
+	printf("%-16s %12s %10s %10s %10s\n", "", "per second", "p50 us", "p90 us", "p99 us");
+	const char* names[2] = { "generate", "solve" };
+	double* times[2] = { makeTimes, solveTimes };
+	for (int n = 0; n < 2; n++) {
+		char metric[BENCH_NAME_LENGTH];
+		double p50 = times[n][BENCH_PUZZLES / 2];
+		double p90 = times[n][(int)(0.9 * (BENCH_PUZZLES - 1))];
+		double p99 = times[n][(int)(0.99 * (BENCH_PUZZLES - 1))];
+		double perSecond = n == 0 ? BENCH_PUZZLES / total : 1e6 / p50;
+		printf("%-16s %12.1f %10.1f %10.1f %10.1f\n", names[n], perSecond, p50, p90, p99);
+
+		if (n == 0) {
+			snprintf(metric, sizeof(metric), "%s.perSecond", names[n]);
+			benchRecord(metric, perSecond, TRUE, BENCH_THROUGHPUT_TOLERANCE);
+		}
+		snprintf(metric, sizeof(metric), "%s.p50us", names[n]);
+		benchRecord(metric, p50, FALSE, BENCH_LATENCY_TOLERANCE);
+		snprintf(metric, sizeof(metric), "%s.p90us", names[n]);
+		benchRecord(metric, p90, FALSE, BENCH_LATENCY_TOLERANCE);
+		snprintf(metric, sizeof(metric), "%s.p99us", names[n]);
+		benchRecord(metric, p99, FALSE, 2 * BENCH_LATENCY_TOLERANCE);
+	}
+}
+
+/* Run a pipeline of BENCH_PIPELINE_PUZZLES puzzles from BENCH_SEED with the thread counts of the benchmark,
+ * writing the puzzles to a temporary file. Records the puzzles made per second.
+ */
+void benchPipeline(void) {
+	static Pipeline pipeline;
+
+	pipeline.count = BENCH_PIPELINE_PUZZLES;
+	pipeline.seed = BENCH_SEED;
+	pipeline.shardId = 0;
+	pipeline.shardCount = 1;
+	pipeline.shared = NULL;
+	pipeline.quiet = TRUE;
+	pipeline.output = tmpfile();
+	if (pipeline.output == NULL) {
+		fprintf(stderr, "Can't make a temporary file for the pipeline\n");
+		return;
+	}
+
+	double start = secondsNow();
+	int failed = executePipeline(&pipeline, BENCH_GRID_THREADS, BENCH_DIG_THREADS, BENCH_GRADE_THREADS);
+	double elapsed = secondsNow() - start;
+	fclose(pipeline.output);
+	if (failed) {
+		return;
+	}
+
+	printf("\npipeline of %d puzzles from seed %d with %d grid, %d dig and %d grade threads: %.1f puzzles/s\n",
+		BENCH_PIPELINE_PUZZLES, BENCH_SEED, BENCH_GRID_THREADS, BENCH_DIG_THREADS, BENCH_GRADE_THREADS,
+		BENCH_PIPELINE_PUZZLES / elapsed);
+	benchRecord("pipeline.perSecond", BENCH_PIPELINE_PUZZLES / elapsed, TRUE, BENCH_THROUGHPUT_TOLERANCE);
+}
+
+/* Compare the metrics of this run with a baseline saved by runBench(), and print every metric of the baseline
+ * with its change. The baseline must come from a build of the same SIZE, VARIANT, seed and thread counts.
+ * When allRun, every benchmark was run and a metric of the baseline this run doesn't have counts as a
+ * regression, as it is missing because its benchmark failed.
+ *
+ * Returns 0 if no metric regressed beyond its tolerance, 1 if the baseline can't be used, 2 on a regression
+ */
+int benchCompare(const char* path, int allRun) {
+	FILE* baseline = fopen(path, "r");
+	char line[256];
+	char expected[256];
+	int regressions = 0;
+
+	if (baseline == NULL) {
+		fprintf(stderr, "Can't read the baseline %s\n", path);
+		return 1;
+	}
+	snprintf(expected, sizeof(expected), BENCH_HEADER "\n", SIZE, VARIANT, BENCH_SEED, BENCH_GRID_THREADS,
+		BENCH_DIG_THREADS, BENCH_GRADE_THREADS);
+	if (fgets(line, sizeof(line), baseline) == NULL || strcmp(line, expected) != 0) {
+		fprintf(stderr, "The baseline %s was not saved by a bench of this build, expected: %s", path, expected);
+		fclose(baseline);
+		return 1;
+	}
+
+	printf("\n%-20s %12s %12s %9s %9s\n", "metric", "baseline", "current", "change", "tolerance");
+	while (fgets(line, sizeof(line), baseline) != NULL) {
+		char name[BENCH_NAME_LENGTH];
+		double value;
+		double tolerance;
+		if (sscanf(line, "%31s %lf %lf", name, &value, &tolerance) != 3 || value <= 0) {
+			continue;  // A blank or malformed line
+		}
+
+		const BenchMetric* metric = NULL;
+		for (int m = 0; m < benchMetricCount && metric == NULL; m++) {
+			metric = strcmp(benchMetrics[m].name, name) == 0 ? &benchMetrics[m] : NULL;
+		}
+		if (metric == NULL) {
+			regressions += allRun;
+			printf("%-20s %12.6g %12s%s\n", name, value, allRun ? "failed" : "not run", allRun ? "  REGRESSION" : "");
+			continue;
+		}
+
+		double change = (metric->value - value) / value * 100;
+		int regressed = metric->higherIsBetter ? change < -tolerance : change > tolerance;
+		regressions += regressed;
+		printf("%-20s %12.6g %12.6g %+8.1f%% %8g%%%s\n", name, value, metric->value, change, tolerance,
+			regressed ? "  REGRESSION" : "");
+	}
+	fclose(baseline);
+
+	printf("%d regression%s against %s\n", regressions, regressions == 1 ? "" : "s", path);
+	return regressions > 0 ? 2 : 0;
+}
+
+/* Make the boards of the microbenchmarks from BENCH_SEED: random solution boards with each active cell
+ * emptied with a chance of one half, as text too, and the list of their empty cells.
+ */
+void benchSetup(void) {
+	seedRandom(BENCH_SEED);
+	benchCellCount = 0;
+	for (int b = 0; b < BENCH_BOARDS; b++) {
+		generateBoard(benchBoards[b]);
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			if (rules.active[cell] && randomInt(2) == 0) {
+				benchBoards[b][cell / GRID_WIDTH][cell % GRID_WIDTH] = EMPTY;
+				benchCells[benchCellCount++] = b * GRID_CELLS + cell;
+			}
+		}
+		formatBoard(benchBoards[b], benchTexts[b]);
+	}
+}
+
+/* Benchmark: the legal integers of an empty cell as a bitmask */
+long long benchCandidateMask(long long operations) {
+	long long sum = 0;
+	int next = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		int board = benchCells[next] / GRID_CELLS;
+		int cell = benchCells[next] % GRID_CELLS;
+		sum += candidateMask(benchBoards[board], cell % GRID_WIDTH, cell / GRID_WIDTH);
+		next = (next + 1 == benchCellCount) ? 0 : next + 1;
+	}
+	return sum;
+}
+
+/* Benchmark: the legal integers of an empty cell as a list of flags */
+long long benchPermittedValue(long long operations) {
+	int permitted[SIZE + 1];
+	long long sum = 0;
+	int next = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		int board = benchCells[next] / GRID_CELLS;
+		int cell = benchCells[next] % GRID_CELLS;
+		permittedValue(benchBoards[board], cell % GRID_WIDTH, cell / GRID_WIDTH, permitted);
+		sum += permitted[1 + (int)(i % SIZE)];
+		next = (next + 1 == benchCellCount) ? 0 : next + 1;
+	}
+	return sum;
+}
+
+/* Benchmark: the empty cell with the fewest legal integers */
+long long benchNextEmpty(long long operations) {
+	long long sum = 0;
+	int xPos = 0;
+	int yPos = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		nextEmpty(benchBoards[i % BENCH_BOARDS], &xPos, &yPos);
+		sum += xPos + yPos;
+	}
+	return sum;
+}
+
+/* Benchmark: the moves the solver branches on, hidden singles included */
+long long benchChooseBranch(long long operations) {
+	DigitMask candidates[GRID_CELLS];
+	long long sum = 0;
+	int cell = 0;
+	DigitMask values = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		chooseBranch(benchBoards[i % BENCH_BOARDS], candidates, &cell, &values);
+		sum += cell + values;
+	}
+	return sum;
+}
+
+/* Benchmark: a random integer below SIZE */
+long long benchRandomInt(long long operations) {
+	long long sum = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		sum += randomInt(SIZE);
+	}
+	return sum;
+}
+
+/* Benchmark: shuffling the list of active cells, as the generators do before digging */
+long long benchShuffle(long long operations) {
+	int listOfCells[GRID_CELLS];
+	int listSize = 0;
+	long long sum = 0;
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		if (rules.active[cell]) {
+			listOfCells[listSize++] = cell;
+		}
+	}
+	for (long long i = 0; i < operations; i++) {
+		shuffleValues(listOfCells, listSize);
+		sum += listOfCells[0];
+	}
+	return sum;
+}
+
+/* Benchmark: copying a board */
+long long benchDuplicateBoard(long long operations) {
+	long long sum = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		duplicateBoard(benchBoards[i % BENCH_BOARDS], benchCopy);
+		sum += benchCopy[i % GRID_WIDTH][0];
+	}
+	return sum;
+}
+
+/* Benchmark: writing a board as a line of text */
+long long benchFormatBoard(long long operations) {
+	char text[GRID_CELLS + 1];
+	long long sum = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		formatBoard(benchBoards[i % BENCH_BOARDS], text);
+		sum += text[i % GRID_CELLS];
+	}
+	return sum;
+}
+
+/* Benchmark: reading a board from a line of text */
+long long benchParseBoard(long long operations) {
+	long long sum = 0;
+
+	for (long long i = 0; i < operations; i++) {
+		sum += parseBoard(benchTexts[i % BENCH_BOARDS], benchCopy);
+	}
+	return sum + benchCopy[0][0];
+}
+
+/* Order doubles for qsort() */
+int compareDoubles(const void* a, const void* b) {
+	double first = *(const double*)a;
+	double second = *(const double*)b;
+	return (first > second) - (first < second);
+}
+
+/* Find the canonical form of a board: of every way to rotate or reflect it that keeps the rules (see
+ * buildSymmetries()) and then number its integers in the order they first appear, the one whose text is first in
+ * sorted order. Boards that are the same puzzle relabeled, rotated or reflected have the same canonical form.
+ * The transform used is left in symmetry and relabel, relabel[n] being the integer n becomes.
+ *
+ * Returns the hash of the canonical form
+ */
+unsigned long long canonicalForm(int board[][GRID_WIDTH], char text[GRID_CELLS + 1], int* symmetry, int relabel[SIZE + 1]) {
+	const int* cells = &board[0][0];
+	char candidate[GRID_CELLS + 1];
+	int labels[SIZE + 1];
+
+	for (int s = 0; s < rules.symmetryCount; s++) {
+		// Number the integers in the order they appear once moved, those missing from the board take what is left
+		int moved[GRID_CELLS];
+		int next = 1;
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			moved[rules.symmetries[s][cell]] = cells[cell];
+		}
+		memset(labels, 0, sizeof(labels));
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			if (moved[cell] != EMPTY && labels[moved[cell]] == 0) {
+				labels[moved[cell]] = next++;
+			}
+		}
+		for (int value = 1; value <= SIZE; value++) {
+			if (labels[value] == 0) {
+				labels[value] = next++;
+			}
+		}
+
+		toCanonical(board, s, labels, candidate);
+		if (s == 0 || strcmp(candidate, text) < 0) {
+			strcpy(text, candidate);
+			*symmetry = s;
+			memcpy(relabel, labels, sizeof(labels));
+		}
+	}
+	return hashText(text);
+}
+
+/* Write a board as text after moving its cells by a symmetry and renumbering its integers by relabel */
+void toCanonical(int board[][GRID_WIDTH], int symmetry, const int relabel[SIZE + 1], char text[GRID_CELLS + 1]) {
+	const int* cells = &board[0][0];
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		int to = rules.symmetries[symmetry][cell];
+		text[to] = !rules.active[cell] ? INACTIVE_CHAR : cellChars[cells[cell] == EMPTY ? EMPTY : relabel[cells[cell]]];
+	}
+	text[GRID_CELLS] = '\0';
+}
+
+/* Undo toCanonical(): read a board in canonical form back into the frame of the board it was made from */
+void fromCanonical(const char text[GRID_CELLS + 1], int symmetry, const int relabel[SIZE + 1], int board[][GRID_WIDTH]) {
+	int* cells = &board[0][0];
+	int original[SIZE + 1];
+
+	original[EMPTY] = EMPTY;
+	for (int value = 1; value <= SIZE; value++) {
+		original[relabel[value]] = value;
+	}
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		const char* found = strchr(cellChars, text[rules.symmetries[symmetry][cell]]);
+		cells[cell] = rules.active[cell] && found != NULL ? original[found - cellChars] : EMPTY;
+	}
+}
+
+/* Make room in a cache for about entries solutions, split evenly over its shards.
+ * Returns FALSE if there isn't the memory for them
+ */
+int cacheInit(SolutionCache* cache, int entries) {
+	int capacity = (entries + CACHE_SHARDS - 1) / CACHE_SHARDS;
+
+	memset(cache, 0, sizeof(*cache));
+	for (int s = 0; s < CACHE_SHARDS; s++) {
+		CacheShard* shard = &cache->shards[s];
+		shard->capacity = capacity;
+		shard->newest = shard->oldest = -1;
+		shard->bucketCount = 1;
+		while (shard->bucketCount < capacity) {
+			shard->bucketCount *= 2;
+		}
+		shard->buckets = malloc(shard->bucketCount * sizeof(int));
+		shard->entries = malloc(capacity * sizeof(CacheEntry));
+		if (shard->buckets == NULL || shard->entries == NULL) {
+			cacheFree(cache);
+			return FALSE;
+		}
+		memset(shard->buckets, -1, shard->bucketCount * sizeof(int));  // Every byte 0xFF, so every bucket -1
+		mtx_init(&shard->lock, mtx_plain);
+	}
+	return TRUE;
+}
+
+void cacheFree(SolutionCache* cache) {
+	for (int s = 0; s < CACHE_SHARDS; s++) {
+		free(cache->shards[s].buckets);
+		free(cache->shards[s].entries);
+		cache->shards[s].buckets = NULL;
+		cache->shards[s].entries = NULL;
+	}
+}
+
+/* Look up the solution of a board in canonical form, marking it as the most recently used.
+ * Returns TRUE with solutions and solution filled in if the cache holds it
+ */
+int cacheLookup(SolutionCache* cache, unsigned long long hash, const char* key, int* solutions, char solution[GRID_CELLS + 1]) {
+	CacheShard* shard = &cache->shards[hash % CACHE_SHARDS];
+	int found = FALSE;
+
+	mtx_lock(&shard->lock);
+	int entry = shard->buckets[(hash / CACHE_SHARDS) & (shard->bucketCount - 1)];
+	while (entry >= 0 && (shard->entries[entry].hash != hash || strcmp(shard->entries[entry].key, key) != 0)) {
+		entry = shard->entries[entry].chain;
+	}
+	if (entry >= 0) {
+		*solutions = shard->entries[entry].solutions;
+		strcpy(solution, shard->entries[entry].solution);
+		cacheUnlink(shard, entry);
+		cacheMakeNewest(shard, entry);
+		shard->hits++;
+		found = TRUE;
+	}
+	else {
+		shard->misses++;
+	}
+	mtx_unlock(&shard->lock);
+	return found;
+}
+
+/* Keep the solution of a board in canonical form, in place of the least recently used one when the shard is full */
+void cacheStore(SolutionCache* cache, unsigned long long hash, const char* key, int solutions, const char* solution) {
+	CacheShard* shard = &cache->shards[hash % CACHE_SHARDS];
+	int bucket = (int)((hash / CACHE_SHARDS) & (shard->bucketCount - 1));
+	int entry;
+
+	if (shard->capacity == 0) {
+		return;
+	}
+	mtx_lock(&shard->lock);
+	entry = shard->buckets[bucket];
+	while (entry >= 0 && (shard->entries[entry].hash != hash || strcmp(shard->entries[entry].key, key) != 0)) {
+		entry = shard->entries[entry].chain;
+	}
+	if (entry >= 0) {
+		cacheUnlink(shard, entry);  // Another thread stored the same board meanwhile
+	}
+	else {
+		if (shard->count < shard->capacity) {
+			entry = shard->count++;
+		}
+		else {
+			// Evict the least recently used entry, taking it out of its bucket too
+			entry = shard->oldest;
+			cacheUnlink(shard, entry);
+			CacheEntry* old = &shard->entries[entry];
+			int* link = &shard->buckets[(old->hash / CACHE_SHARDS) & (shard->bucketCount - 1)];
+			while (*link != entry) {
+				link = &shard->entries[*link].chain;
+			}
+			*link = old->chain;
+		}
+		shard->entries[entry].hash = hash;
+		strcpy(shard->entries[entry].key, key);
+		shard->entries[entry].chain = shard->buckets[bucket];
+		shard->buckets[bucket] = entry;
+	}
+	shard->entries[entry].solutions = solutions;
+	strcpy(shard->entries[entry].solution, solution);
+	cacheMakeNewest(shard, entry);
+	mtx_unlock(&shard->lock);
+}
+
+/* Take an entry out of the least recently used order of its shard */
+void cacheUnlink(CacheShard* shard, int entry) {
+	CacheEntry* e = &shard->entries[entry];
+
+	if (e->newer >= 0) {
+		shard->entries[e->newer].older = e->older;
+	}
+	else {
+		shard->newest = e->older;
+	}
+	if (e->older >= 0) {
+		shard->entries[e->older].newer = e->newer;
+	}
+	else {
+		shard->oldest = e->newer;
+	}
+}
+
+/* Put an entry first in the least recently used order of its shard */
+void cacheMakeNewest(CacheShard* shard, int entry) {
+	CacheEntry* e = &shard->entries[entry];
+
+	e->newer = -1;
+	e->older = shard->newest;
+	if (shard->newest >= 0) {
+		shard->entries[shard->newest].newer = entry;
+	}
+	else {
+		shard->oldest = entry;
+	}
+	shard->newest = entry;
+}
+
+/* Make one shard of a sharded run, so that several processes or machines can share a run without talking to
+ * each other. Arguments: <count> <seed> <shardId> <shardCount> <archive> [gridThreads digThreads gradeThreads]
+ * The run is the puzzles 0 ... count - 1 of a seed, and shard i makes those whose number leaves i when divided
+ * by shardCount, each one from its own random numbers exactly as runPipeline() would make it.
+ * The archive starts with a header naming the build, seed, count and shard, holds one puzzle per line
+ * (index grade clues board) and ends with a line counting the puzzles, so runMerge() can tell an archive cut
+ * short from a complete one.
+ *
+ * Returns 0 when done, 1 for bad arguments or an archive that can't be written
+ */
+int runShard(int argc, char* argv[]) {
+	static Pipeline pipeline;
+	int count = argc > 0 ? atoi(argv[0]) : 0;
+	int shardId = argc > 2 ? atoi(argv[2]) : -1;
+	int shardCount = argc > 3 ? atoi(argv[3]) : 0;
+	int gridThreads = argc > 5 ? atoi(argv[5]) : 1;
+	int digThreads = argc > 6 ? atoi(argv[6]) : 2;
+	int gradeThreads = argc > 7 ? atoi(argv[7]) : 1;
+	char temporaryPath[MAX_PATH_LENGTH + 4];
+
+	if (argc < 5 || count < 1 || shardCount < 1 || shardId < 0 || shardId >= shardCount || gridThreads < 1
+		|| digThreads < 1 || gradeThreads < 1 || gridThreads + digThreads + gradeThreads + 2 > MAX_THREADS
+		|| strlen(argv[4]) >= MAX_PATH_LENGTH) {
+		fprintf(stderr, "Usage: shard <count> <seed> <shardId 0-(shardCount-1)> <shardCount> <archive>"
+			" [gridThreads digThreads gradeThreads]\n");
+		return 1;
+	}
+	if (VARIANT == KILLER) {
+		fprintf(stderr, "Shards of KILLER puzzles are not supported, the board text does not hold the cages.\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	// The archive only takes its name once complete, a shard that was stopped leaves no archive behind
+	sprintf(temporaryPath, "%s.tmp", argv[4]);
+	pipeline.output = fopen(temporaryPath, "w");
+	if (pipeline.output == NULL) {
+		fprintf(stderr, "Can't create %s\n", temporaryPath);
+		return 1;
+	}
+	pipeline.seed = strtoull(argv[1], NULL, 0);
+	pipeline.shardId = shardId;
+	pipeline.shardCount = shardCount;
+	pipeline.count = (count - shardId + shardCount - 1) / shardCount;  // The puzzle numbers that fall in this shard
+	fprintf(pipeline.output, "sudokuPuzzles archive size %d variant %d seed %llu count %d shard %d of %d\n",
+		SIZE, VARIANT, pipeline.seed, count, shardId, shardCount);
+
+	if (executePipeline(&pipeline, gridThreads, digThreads, gradeThreads) != 0) {
+		fclose(pipeline.output);
+		return 1;
+	}
+	fprintf(pipeline.output, "end %d\n", pipeline.written);
+	int written = !ferror(pipeline.output);
+	written = (fclose(pipeline.output) == 0) && written;
+#if defined(_WIN32)
+	remove(argv[4]);  // rename() doesn't replace an existing file on Windows
+#endif
+	if (!written || rename(temporaryPath, argv[4]) != 0) {
+		fprintf(stderr, "Can't write the archive %s\n", argv[4]);
+		return 1;
+	}
+	return 0;
+}
+
+/* Combine the archives of every shard of a run into one output. Arguments: <output> <archive>...
+ * Every archive is checked: it must be complete, come from this build and from the same run as the others,
+ * and each puzzle must belong to its shard, have the clues and grade it claims and a unique solution.
+ * Puzzles are written in index order as: index grade clues board, dropping a puzzle already made under a
+ * smaller index. <output>.index lists the byte offset of each puzzle in the output: index offset
+ *
+ * Returns 0 when merged, 1 if an archive is missing or fails a check
+ */
+int runMerge(int argc, char* argv[]) {
+	ArchiveRecord* records = NULL;
+	int recordCount = 0;
+	int recordSize = 0;
+	static int shardSeen[MAX_SHARDS];
+	int run[4] = { 0 };            // count, shardId, shardCount and records of the first archive
+	unsigned long long runSeed = 0;
+	char indexPath[MAX_PATH_LENGTH + 8];
+	FILE* output;
+	FILE* index;
+
+	if (argc < 2 || strlen(argv[0]) >= MAX_PATH_LENGTH) {
+		fprintf(stderr, "Usage: merge <output> <archive>...\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+
+	for (int a = 1; a < argc; a++) {
+		int header[4];
+		unsigned long long seed;
+		if (!readArchive(argv[a], &records, &recordCount, &recordSize, header, &seed)) {
+			free(records);
+			return 1;
+		}
+		if (a == 1) {
+			memcpy(run, header, sizeof(run));
+			runSeed = seed;
+			if (run[2] > MAX_SHARDS) {
+				fprintf(stderr, "%s: too many shards to merge\n", argv[a]);
+				free(records);
+				return 1;
+			}
+		}
+		else if (seed != runSeed || header[0] != run[0] || header[2] != run[2]) {
+			fprintf(stderr, "%s is a shard of a different run than %s\n", argv[a], argv[1]);
+			free(records);
+			return 1;
+		}
+		if (shardSeen[header[1]]++) {
+			fprintf(stderr, "%s: shard %d is given twice\n", argv[a], header[1]);
+			free(records);
+			return 1;
+		}
+	}
+	for (int shard = 0; shard < run[2]; shard++) {
+		if (!shardSeen[shard]) {
+			fprintf(stderr, "The archive of shard %d of %d is missing\n", shard, run[2]);
+			free(records);
+			return 1;
+		}
+	}
+
+	// Sort by board to find the duplicates, keeping the one with the smallest index, then back into index order
+	qsort(records, recordCount, sizeof(ArchiveRecord), compareRecordBoards);
+	int kept = 0;
+	for (int i = 0; i < recordCount; i++) {
+		if (kept == 0 || strcmp(records[i].board, records[kept - 1].board) != 0) {
+			records[kept++] = records[i];
+		}
+	}
+	qsort(records, kept, sizeof(ArchiveRecord), compareRecordIndexes);
+
+	sprintf(indexPath, "%s.index", argv[0]);
+	output = fopen(argv[0], "w");
+	index = fopen(indexPath, "w");
+	if (output == NULL || index == NULL) {
+		fprintf(stderr, "Can't create %s and %s\n", argv[0], indexPath);
+		free(records);
+		return 1;
+	}
+	for (int i = 0; i < kept; i++) {
+		fprintf(index, "%d %ld\n", records[i].index, ftell(output));
+		fprintf(output, "%d %s %d %s\n", records[i].index, gradeNames[records[i].grade], records[i].clues,
+			records[i].board);
+	}
+	int written = !ferror(output) && !ferror(index);
+	written = (fclose(output) == 0) && written;
+	written = (fclose(index) == 0) && written;
+	free(records);
+	if (!written) {
+		fprintf(stderr, "Can't write %s\n", argv[0]);
+		return 1;
+	}
+	fprintf(stderr, "%d shards merged: %d puzzles, %d duplicates dropped\n", run[2], kept, recordCount - kept);
+	return 0;
+}
+
+/* Read and check one shard archive for runMerge(), adding its puzzles to *records (grown as needed).
+ * header gets the count, shard id and shard count of the run and seed its seed.
+ *
+ * Returns TRUE if the archive passed every check, otherwise FALSE with a message naming the problem
+ */
+int readArchive(const char* path, ArchiveRecord** records, int* recordCount, int* recordSize, int header[4],
+	unsigned long long* seed) {
+	FILE* archive = fopen(path, "r");
+	char line[GRID_CELLS + 64];
+	int size, variant, lineNumber = 1, found = 0, ended = -1, lastIndex = -1, trailing = FALSE;
+
+	if (archive == NULL) {
+		fprintf(stderr, "Can't open %s\n", path);
+		return FALSE;
+	}
+	if (fgets(line, sizeof(line), archive) == NULL
+		|| sscanf(line, "sudokuPuzzles archive size %d variant %d seed %llu count %d shard %d of %d", &size, &variant,
+			seed, &header[0], &header[1], &header[2]) != 6
+		|| header[2] < 1 || header[1] < 0 || header[1] >= header[2]) {
+		fprintf(stderr, "%s is not a shard archive\n", path);
+		fclose(archive);
+		return FALSE;
+	}
+	if (size != SIZE || variant != VARIANT) {
+		fprintf(stderr, "%s holds puzzles of size %d variant %d, this build is size %d variant %d\n", path, size,
+			variant, SIZE, VARIANT);
+		fclose(archive);
+		return FALSE;
+	}
+
+	while (fgets(line, sizeof(line), archive) != NULL) {
+		lineNumber++;
+		if (ended >= 0) {
+			trailing = TRUE;  // Anything after the end line is an error
+			break;
+		}
+		if (sscanf(line, "end %d", &ended) == 1) {
+			continue;
+		}
+
+		ArchiveRecord record;
+		char gradeName[16];
+		char format[48];
+		int board[GRID_WIDTH][GRID_WIDTH];
+		int solution[GRID_WIDTH][GRID_WIDTH];
+		sprintf(format, "%%d %%15s %%d %%%ds", GRID_CELLS);
+		record.grade = -1;
+		int valid = sscanf(line, format, &record.index, gradeName, &record.clues, record.board) == 4
+			&& record.index > lastIndex && record.index < header[0] && record.index % header[2] == header[1]
+			&& parseBoard(record.board, board);
+		for (int g = 0; valid && g < GRADES; g++) {
+			if (strcmp(gradeName, gradeNames[g]) == 0) {
+				record.grade = g;
+			}
+		}
+		if (valid) {
+			int clues = 0;
+			for (int cell = 0; cell < GRID_CELLS; cell++) {
+				clues += rules.active[cell] && (&board[0][0])[cell] != EMPTY;
+			}
+			valid = record.grade >= 0 && clues == record.clues && gradePuzzle(board) == record.grade
+				&& countSolutions(board, solution, 2) == 1;
+		}
+		if (!valid) {
+			fprintf(stderr, "%s line %d is not a valid puzzle of shard %d of %d\n", path, lineNumber, header[1],
+				header[2]);
+			fclose(archive);
+			return FALSE;
+		}
+		lastIndex = record.index;
+
+		if (*recordCount == *recordSize) {
+			int grown = *recordSize ? 2 * *recordSize : 1024;
+			ArchiveRecord* more = realloc(*records, (size_t)grown * sizeof(ArchiveRecord));
+			if (more == NULL) {
+				fprintf(stderr, "Not enough memory to merge %s\n", path);
+				fclose(archive);
+				return FALSE;
+			}
+			*records = more;
+			*recordSize = grown;
+		}
+		(*records)[(*recordCount)++] = record;
+		found++;
+	}
+	fclose(archive);
+	if (ended != found || trailing) {
+		fprintf(stderr, "%s is incomplete or damaged: %d puzzles, end line %s\n", path, found,
+			ended < 0 ? "missing" : trailing ? "not last" : "disagrees");
+		return FALSE;
+	}
+	header[3] = found;
+	return TRUE;
+}
+
+/* Order archive records by board text, then index, for qsort() */
+int compareRecordBoards(const void* a, const void* b) {
+	const ArchiveRecord* first = (const ArchiveRecord*)a;
+	const ArchiveRecord* second = (const ArchiveRecord*)b;
+	int order = strcmp(first->board, second->board);
+	return order != 0 ? order : (first->index > second->index) - (first->index < second->index);
+}
+
+/* Order archive records by index, for qsort() */
+int compareRecordIndexes(const void* a, const void* b) {
+	const ArchiveRecord* first = (const ArchiveRecord*)a;
+	const ArchiveRecord* second = (const ArchiveRecord*)b;
+	return (first->index > second->index) - (first->index < second->index);
+}
+
+#if defined(__linux__)
+
+/* Hand out the puzzles of a run to worker processes connecting to a Unix domain socket, and collect them.
+ * Arguments: <socket> <count> <seed> <unitSize> [localWorkers]
+ * The run is the puzzles 0 ... count - 1 of the seed, made as runPipeline() would, in units of unitSize
+ * puzzles. A worker asks for a unit with "next" and gets "unit <id> <first> <last> <seed>", sends back one
+ * line per puzzle and then "finished <id>"; when nothing is left to hand out it gets "wait", and "done" once
+ * the run is complete. A worker that disconnects gives its unit back, and a unit held for longer than
+ * UNIT_TIMEOUT_SECONDS is also handed to an idle worker, the first to finish it wins. Every puzzle only
+ * depends on its index, so it doesn't matter which worker makes it.
+ * localWorkers starts that many workers as child processes. The puzzles are written to stdout in index order
+ * as: index grade clues board, with duplicates dropped, exactly as runPipeline() writes them.
+ *
+ * Returns 0 once the run is complete, 1 for bad arguments or if the socket can't be opened
+ */
+int runCoordinator(int argc, char* argv[]) {
+	static WorkerConnection workers[MAX_WORKERS];
+	struct pollfd polls[MAX_WORKERS + 1];
+	struct sockaddr_un address;
+	int count = argc > 1 ? atoi(argv[1]) : 0;
+	int unitSize = argc > 3 ? atoi(argv[3]) : 0;
+	int localWorkers = argc > 4 ? atoi(argv[4]) : 0;
+
+	if (argc < 4 || count < 1 || unitSize < 1 || localWorkers < 0 || localWorkers > MAX_WORKERS
+		|| strlen(argv[0]) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Usage: coordinate <socket> <count> <seed> <unitSize> [localWorkers 0-%d]\n", MAX_WORKERS);
+		return 1;
+	}
+	unsigned long long seed = strtoull(argv[2], NULL, 0);
+	int unitCount = (count + unitSize - 1) / unitSize;
+	WorkUnit* units = calloc(unitCount, sizeof(WorkUnit));
+	char** results = calloc(count, sizeof(char*));  // The line of each puzzle received, NULL until then
+	if (units == NULL || results == NULL) {
+		fprintf(stderr, "Not enough memory for %d puzzles\n", count);
+		return 1;
+	}
+	for (int u = 0; u < unitCount; u++) {
+		units[u].firstIndex = u * unitSize;
+		units[u].lastIndex = u == unitCount - 1 ? count - 1 : (u + 1) * unitSize - 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);  // A worker that died is noticed by its read failing, not by a signal
+	int listener = openListener(argv[0]);
+	if (listener < 0) {
+		return 1;
+	}
+
+	// The local workers are copies of this process, started once the socket is ready for them
+	fflush(stdout);
+	fflush(stderr);
+	for (int w = 0; w < localWorkers; w++) {
+		if (fork() == 0) {
+			close(listener);
+			exit(runWorker(1, argv));
+		}
+	}
+
+	for (int w = 0; w < MAX_WORKERS; w++) {
+		workers[w].socket = -1;
+	}
+	int unitsLeft = unitCount;
+	int reassigned = 0;
+	int connections = 0;
+	double start = secondsNow();
+	while (unitsLeft > 0) {
+		int pollCount = 0;
+		polls[pollCount].fd = listener;
+		polls[pollCount++].events = POLLIN;
+		for (int w = 0; w < MAX_WORKERS; w++) {
+			if (workers[w].socket >= 0) {
+				polls[pollCount].fd = workers[w].socket;
+				polls[pollCount++].events = POLLIN;
+			}
+		}
+		if (poll(polls, pollCount, 1000) <= 0) {
+			continue;
+		}
+
+		if (polls[0].revents & POLLIN) {
+			int client = accept(listener, NULL, NULL);
+			int slot = 0;
+			while (slot < MAX_WORKERS && workers[slot].socket >= 0) {
+				slot++;
+			}
+			if (client >= 0 && slot == MAX_WORKERS) {
+				close(client);  // No room for another worker
+			}
+			else if (client >= 0) {
+				workers[slot].socket = client;
+				workers[slot].unit = -1;
+				workers[slot].unitsFinished = 0;
+				workers[slot].length = 0;
+				connections++;
+			}
+		}
+
+		for (int p = 1; p < pollCount; p++) {
+			WorkerConnection* worker = NULL;
+			for (int w = 0; w < MAX_WORKERS; w++) {
+				if (workers[w].socket == polls[p].fd) {
+					worker = &workers[w];
+				}
+			}
+			if (worker == NULL || !(polls[p].revents & (POLLIN | POLLHUP | POLLERR))) {
+				continue;
+			}
+
+			ssize_t received = read(worker->socket, worker->buffer + worker->length, sizeof(worker->buffer) - 1 - worker->length);
+			if (received <= 0) {
+				// The worker is gone, its unit goes back to be handed out again
+				if (worker->unit >= 0) {
+					units[worker->unit].holders--;
+					reassigned += !units[worker->unit].finished;
+				}
+				close(worker->socket);
+				worker->socket = -1;
+				continue;
+			}
+			worker->length += (int)received;
+
+			// Act on every complete line
+			char* newline;
+			while ((newline = memchr(worker->buffer, '\n', worker->length)) != NULL) {
+				*newline = '\0';
+				char* line = worker->buffer;
+				int index, unit;
+				char reply[128];
+
+				if (strcmp(line, "next") == 0) {
+					double now = secondsNow();
+					int chosen = -1;
+					for (int u = 0; u < unitCount && chosen < 0; u++) {
+						if (!units[u].finished && units[u].holders == 0) {
+							chosen = u;  // A unit nobody is making
+						}
+					}
+					for (int u = 0; u < unitCount && chosen < 0; u++) {
+						if (!units[u].finished && now - units[u].assignedAt > UNIT_TIMEOUT_SECONDS) {
+							chosen = u;  // A unit that is taking too long, let this worker race the slow one
+							reassigned++;
+						}
+					}
+					if (chosen >= 0) {
+						units[chosen].holders++;
+						units[chosen].assignedAt = now;
+						worker->unit = chosen;
+						sprintf(reply, "unit %d %d %d %llu\n", chosen, units[chosen].firstIndex, units[chosen].lastIndex, seed);
+					}
+					else {
+						strcpy(reply, "wait\n");
+					}
+					if (write(worker->socket, reply, strlen(reply)) < 0) {
+						worker->length = 0;  // Found out when its read fails
+					}
+				}
+				else if (sscanf(line, "finished %d", &unit) == 1) {
+					if (unit >= 0 && unit < unitCount && !units[unit].finished) {
+						units[unit].finished = TRUE;
+						unitsLeft--;
+						worker->unitsFinished++;
+					}
+					if (unit == worker->unit) {
+						units[unit].holders--;
+						worker->unit = -1;
+					}
+				}
+				else if (sscanf(line, "%d", &index) == 1 && worker->unit >= 0 && index >= units[worker->unit].firstIndex
+					&& index <= units[worker->unit].lastIndex && results[index] == NULL) {
+					results[index] = malloc(strlen(line) + 1);
+					if (results[index] != NULL) {
+						strcpy(results[index], line);
+					}
+				}
+
+				int used = (int)(newline - worker->buffer) + 1;
+				memmove(worker->buffer, newline + 1, worker->length - used);
+				worker->length -= used;
+			}
+			if (worker->length == (int)sizeof(worker->buffer) - 1) {
+				worker->length = 0;  // A line too long to be from a worker, drop it
+			}
+		}
+	}
+
+	// Tell every worker still connected that the run is over
+	for (int w = 0; w < MAX_WORKERS; w++) {
+		if (workers[w].socket >= 0) {
+			if (write(workers[w].socket, "done\n", 5) < 0) {
+				workers[w].length = 0;
+			}
+			close(workers[w].socket);
+		}
+	}
+	close(listener);
+	unlink(argv[0]);
+	while (localWorkers-- > 0) {
+		wait(NULL);
+	}
+
+	// Write the puzzles in index order, dropping any made before under a smaller index as the pipeline does
+	int seenSize = 1;
+	while (seenSize < 2 * count) {
+		seenSize *= 2;
+	}
+	unsigned long long* seen = calloc(seenSize, sizeof(unsigned long long));
+	int written = 0;
+	for (int i = 0; i < count; i++) {
+		char* board = results[i] != NULL ? strrchr(results[i], ' ') : NULL;
+		if (board == NULL || seen == NULL) {
+			continue;
+		}
+		unsigned long long hash = hashText(board + 1) | 1;
+		int slot = (int)(hash & (seenSize - 1));
+		while (seen[slot] != 0 && seen[slot] != hash) {
+			slot = (slot + 1) & (seenSize - 1);
+		}
+		if (seen[slot] == 0) {
+			seen[slot] = hash;
+			printf("%s\n", results[i]);
+			written++;
+		}
+		free(results[i]);
+	}
+	fprintf(stderr, "%d puzzles from %d units in %.3f s, %d worker connections, %d units handed out again\n",
+		written, unitCount, secondsNow() - start, connections, reassigned);
+	free(seen);
+	free(results);
+	free(units);
+	return 0;
+}
+
+/* Open a Unix domain socket at path for clients to connect to, replacing any old socket file.
+ * Returns the listening socket, or -1 (with a message) if it can't be opened
+ */
+int openListener(const char* path) {
+	struct sockaddr_un address;
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0
+		|| listen(listener, MAX_WORKERS) != 0) {
+		fprintf(stderr, "Can't listen on %s\n", path);
+		if (listener >= 0) {
+			close(listener);
+		}
+		return -1;
+	}
+	return listener;
+}
+
+/* Answer solve requests from clients connected to a Unix domain socket.
+ * Arguments: <socket> [windowMicroseconds [maxBatch [solverThreads [cacheEntries]]]]
+ * A request is one line holding a board as text (see formatBoard()) and its answer one line:
+ *     solutions <n> [solution]    n is 0, 1, or 2 for more than one solution
+ *     error <message>
+ * Requests from every client that arrive within windowMicroseconds (SERVICE_WINDOW_MICROSECONDS) of the first
+ * one of a batch, up to maxBatch of them, are solved together by the solver threads, which spreads one batch
+ * over every thread for the cost of a single hand-over and solves a board requested several times only once.
+ * A request arriving to an idle service waits at most the window for its batch to start.
+ * The last cacheEntries (CACHE_ENTRIES, 0 for none) puzzles solved are kept in a SolutionCache.
+ * The line "shutdown" from any client stops the service.
+ *
+ * Returns 0 after a shutdown, 1 for bad arguments or if the socket can't be opened
+ */
+int runService(int argc, char* argv[]) {
+	static ClientConnection clients[MAX_CLIENTS];
+	static SolveRequest batch[MAX_BATCH];
+	static BatchSolver solver;
+	static SolutionCache cache;
+	struct pollfd polls[MAX_CLIENTS + 1];
+	thrd_t threads[MAX_THREADS];
+	struct sockaddr_un address;
+	long window = argc > 1 ? atol(argv[1]) : SERVICE_WINDOW_MICROSECONDS;
+	int maxBatch = argc > 2 ? atoi(argv[2]) : MAX_BATCH;
+	int threadCount = argc > 3 ? atoi(argv[3]) : 1;
+	int cacheEntries = argc > 4 ? atoi(argv[4]) : CACHE_ENTRIES;
+
+	if (argc < 1 || strlen(argv[0]) >= sizeof(address.sun_path) || window < 0 || maxBatch < 1
+		|| maxBatch > MAX_BATCH || threadCount < 1 || threadCount > MAX_THREADS || cacheEntries < 0) {
+		fprintf(stderr, "Usage: serve <socket> [windowMicroseconds [maxBatch 1-%d [solverThreads 1-%d [cacheEntries]]]]\n",
+			MAX_BATCH, MAX_THREADS);
+		return 1;
+	}
+	if (VARIANT == KILLER || !buildRules(VARIANT)) {
+		fprintf(stderr, "The service can't solve puzzles of this variant and size\n");
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);  // A client that left is noticed by its write failing, not by a signal
+	int listener = openListener(argv[0]);
+	if (listener < 0) {
+		return 1;
+	}
+
+	if (cacheEntries > 0) {
+		if (!cacheInit(&cache, cacheEntries)) {
+			fprintf(stderr, "No memory for a cache of %d solutions\n", cacheEntries);
+			return 1;
+		}
+		solver.cache = &cache;
+	}
+	mtx_init(&solver.lock, mtx_plain);
+	cnd_init(&solver.started);
+	cnd_init(&solver.finished);
+	solver.threads = threadCount;
+	for (int t = 0; t < threadCount; t++) {
+		thrd_create(&threads[t], batchSolverThread, &solver);
+	}
+	for (int c = 0; c < MAX_CLIENTS; c++) {
+		clients[c].socket = -1;
+	}
+
+	int batchCount = 0;
+	double deadline = 0.0;  // When the batch being gathered must be solved
+	long long requests = 0;
+	long long batches = 0;
+	int stopping = FALSE;
+	while (!stopping) {
+		// Wait for requests, no longer than the time left to gather the current batch
+		struct timespec timeout;
+		double left = batchCount > 0 ? deadline - secondsNow() : 0.0;
+		if (left < 0.0) {
+			left = 0.0;
+		}
+		timeout.tv_sec = (time_t)left;
+		timeout.tv_nsec = (long)((left - (double)timeout.tv_sec) * 1e9);
+
+		// A client that has sent everything is closed once every request it made is answered
+		for (int c = 0; c < MAX_CLIENTS; c++) {
+			if (clients[c].socket >= 0 && !clients[c].reading && clients[c].pending == 0 && clients[c].outputLength == 0
+				&& memchr(clients[c].buffer, '\n', clients[c].length) == NULL) {
+				close(clients[c].socket);
+				clients[c].socket = -1;
+			}
+		}
+
+		int pollCount = 0;
+		polls[pollCount].fd = listener;
+		polls[pollCount++].events = POLLIN;
+		for (int c = 0; c < MAX_CLIENTS; c++) {
+			// A full buffer holds lines waiting for the next batch, the client isn't read until they are taken.
+			// Nor is a client that isn't reading its answers, they are sent as its socket takes them
+			short events = 0;
+			if (clients[c].reading && clients[c].length < (int)sizeof(clients[c].buffer) - 1
+				&& clients[c].outputLength < MAX_CLIENT_OUTPUT) {
+				events |= POLLIN;
+			}
+			if (clients[c].outputLength > 0) {
+				events |= POLLOUT;
+			}
+			if (clients[c].socket >= 0 && events != 0) {
+				polls[pollCount].fd = clients[c].socket;
+				polls[pollCount++].events = events;
+			}
+		}
+		int ready = ppoll(polls, pollCount, batchCount > 0 ? &timeout : NULL, NULL);
+
+		if (ready > 0 && (polls[0].revents & POLLIN)) {
+			int connection = accept(listener, NULL, NULL);
+			int slot = 0;
+			while (slot < MAX_CLIENTS && clients[slot].socket >= 0) {
+				slot++;
+			}
+			if (connection >= 0 && (slot == MAX_CLIENTS || fcntl(connection, F_SETFL, O_NONBLOCK) != 0)) {
+				close(connection);  // No room for another client
+			}
+			else if (connection >= 0) {
+				clients[slot].socket = connection;
+				clients[slot].generation++;
+				clients[slot].reading = TRUE;
+				clients[slot].pending = 0;
+				clients[slot].length = 0;
+				clients[slot].outputLength = 0;
+			}
+		}
+		for (int p = 1; ready > 0 && p < pollCount; p++) {
+			int c = 0;
+			while (c < MAX_CLIENTS && clients[c].socket != polls[p].fd) {
+				c++;
+			}
+			if (c == MAX_CLIENTS) {
+				continue;
+			}
+			if ((polls[p].revents & (POLLOUT | POLLHUP | POLLERR)) && clients[c].outputLength > 0
+				&& !sendAnswers(&clients[c])) {
+				close(clients[c].socket);  // The client is gone, the answers still queued for it are dropped
+				clients[c].socket = -1;
+				continue;
+			}
+			if (!(polls[p].events & POLLIN) || !(polls[p].revents & (POLLIN | POLLHUP | POLLERR))) {
+				continue;
+			}
+			ssize_t received = read(clients[c].socket, clients[c].buffer + clients[c].length,
+				sizeof(clients[c].buffer) - 1 - clients[c].length);
+			if (received == 0) {
+				clients[c].reading = FALSE;  // Finished sending, the answers it is owed are still written
+				continue;
+			}
+			if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+				continue;
+			}
+			if (received < 0) {
+				close(clients[c].socket);  // The client is gone, any answers it was waiting for are dropped
+				clients[c].socket = -1;
+				continue;
+			}
+			clients[c].length += (int)received;
+			int before = batchCount;
+			stopping |= takeRequests(&clients[c], c, batch, &batchCount, maxBatch);
+			if (before == 0 && batchCount > 0) {
+				deadline = secondsNow() + window * 1e-6;  // The first request of a batch starts its window
+			}
+		}
+
+		// Solve the batch once it is full or its window has passed, then answer every request in it
+		while (batchCount > 0 && (batchCount == maxBatch || secondsNow() >= deadline || stopping)) {
+			solveBatch(&solver, batch, batchCount);
+			for (int r = 0; r < batchCount; r++) {
+				char answer[GRID_CELLS + 32];
+				SolveRequest* request = &batch[r];
+				if (request->solutions < 0) {
+					strcpy(answer, "error not a board of this size and variant\n");
+				}
+				else if (request->solutions == 0) {
+					strcpy(answer, "solutions 0\n");
+				}
+				else {
+					sprintf(answer, "solutions %d %s\n", request->solutions, request->solution);
+				}
+				ClientConnection* client = &clients[request->client];
+				if (client->socket < 0 || client->generation != request->generation) {
+					continue;  // Asked by a client that has left since
+				}
+				client->pending--;
+				if (!queueAnswer(client, answer)) {
+					close(client->socket);  // No memory to hold its answers, the client is dropped
+					client->socket = -1;
+				}
+			}
+			for (int c = 0; c < MAX_CLIENTS; c++) {
+				if (clients[c].socket >= 0 && clients[c].outputLength > 0 && !sendAnswers(&clients[c])) {
+					close(clients[c].socket);
+					clients[c].socket = -1;
+				}
+			}
+			requests += batchCount;
+			batches++;
+			batchCount = 0;
+
+			// Requests left waiting in the buffers of the clients because the batch was full start the next one
+			for (int c = 0; c < MAX_CLIENTS; c++) {
+				if (clients[c].socket >= 0) {
+					stopping |= takeRequests(&clients[c], c, batch, &batchCount, maxBatch);
+				}
+			}
+			deadline = secondsNow() + window * 1e-6;
+		}
+	}
+
+	mtx_lock(&solver.lock);
+	solver.stopping = TRUE;
+	cnd_broadcast(&solver.started);
+	mtx_unlock(&solver.lock);
+	for (int t = 0; t < threadCount; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	for (int c = 0; c < MAX_CLIENTS; c++) {
+		if (clients[c].socket >= 0) {
+			sendAnswers(&clients[c]);  // Whatever the socket takes without waiting
+			close(clients[c].socket);
+		}
+		free(clients[c].output);
+	}
+	close(listener);
+	unlink(argv[0]);
+	fprintf(stderr, "%lld requests in %lld batches, %.1f requests per batch\n", requests, batches,
+		batches ? (double)requests / batches : 0.0);
+	if (solver.cache != NULL) {
+		long long hits = 0, misses = 0;
+		for (int s = 0; s < CACHE_SHARDS; s++) {
+			hits += cache.shards[s].hits;
+			misses += cache.shards[s].misses;
+		}
+		fprintf(stderr, "Solution cache: %lld hits, %lld misses\n", hits, misses);
+		cacheFree(&cache);
+	}
+	return 0;
+}
+
+/* Move the complete request lines of a client into the batch, while there is room for them.
+ * Returns TRUE if the client asked for the service to shut down
+ */
+int takeRequests(ClientConnection* client, int clientNumber, SolveRequest* batch, int* batchCount, int maxBatch) {
+	char* newline;
+	int shutdown = FALSE;
+
+	while (*batchCount < maxBatch && (newline = memchr(client->buffer, '\n', client->length)) != NULL) {
+		*newline = '\0';
+		if (newline > client->buffer && newline[-1] == '\r') {
+			newline[-1] = '\0';
+		}
+		if (strcmp(client->buffer, "shutdown") == 0) {
+			shutdown = TRUE;
+		}
+		else if (client->buffer[0] != '\0') {
+			SolveRequest* request = &batch[(*batchCount)++];
+			request->client = clientNumber;
+			request->generation = client->generation;
+			client->pending++;
+			strncpy(request->board, client->buffer, GRID_CELLS);
+			request->board[GRID_CELLS] = '\0';
+			request->solutions = strlen(client->buffer) == GRID_CELLS ? 0 : -1;
+		}
+		int used = (int)(newline - client->buffer) + 1;
+		memmove(client->buffer, newline + 1, client->length - used);
+		client->length -= used;
+	}
+	if (client->length == (int)sizeof(client->buffer) - 1 && memchr(client->buffer, '\n', client->length) == NULL) {
+		client->length = 0;  // A line too long to be a board, drop it
+	}
+	return shutdown;
+}
+
+/* Add an answer to those queued for a client. Returns FALSE if there is no memory for it */
+int queueAnswer(ClientConnection* client, const char* answer) {
+	int length = (int)strlen(answer);
+
+	if (client->outputLength + length > client->outputSize) {
+		int size = client->outputSize > 0 ? client->outputSize : 4096;
+		while (size < client->outputLength + length) {
+			size *= 2;
+		}
+		char* grown = realloc(client->output, size);
+		if (grown == NULL) {
+			return FALSE;
+		}
+		client->output = grown;
+		client->outputSize = size;
+	}
+	memcpy(client->output + client->outputLength, answer, length);
+	client->outputLength += length;
+	return TRUE;
+}
+
+/* Write as many of the answers queued for a client as its socket takes without waiting.
+ * Returns FALSE if the client is gone
+ */
+int sendAnswers(ClientConnection* client) {
+	int sent = 0;
+
+	while (sent < client->outputLength) {
+		ssize_t written = write(client->socket, client->output + sent, client->outputLength - sent);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			return FALSE;
+		}
+		if (written < 0) {
+			break;  // The rest goes when poll finds room for it
+		}
+		sent += (int)written;
+	}
+	memmove(client->output, client->output + sent, client->outputLength - sent);
+	client->outputLength -= sent;
+	return TRUE;
+}
+
+/* Solve a batch of requests with the solver threads and wait for them to finish.
+ * A board requested more than once in the batch is solved once and its answer copied.
+ */
+void solveBatch(BatchSolver* solver, SolveRequest* requests, int requestCount) {
+	for (int r = 0; r < requestCount; r++) {
+		requests[r].sameAs = -1;
+		for (int earlier = 0; earlier < r && requests[r].solutions >= 0; earlier++) {
+			if (requests[earlier].sameAs < 0 && strcmp(requests[earlier].board, requests[r].board) == 0) {
+				requests[r].sameAs = earlier;
+				break;
+			}
+		}
+	}
+
+	mtx_lock(&solver->lock);
+	solver->requests = requests;
+	solver->requestCount = requestCount;
+	atomic_store(&solver->nextRequest, 0);
+	solver->working = solver->threads;
+	solver->batch++;
+	cnd_broadcast(&solver->started);
+	while (solver->working > 0) {
+		cnd_wait(&solver->finished, &solver->lock);
+	}
+	mtx_unlock(&solver->lock);
+
+	for (int r = 0; r < requestCount; r++) {
+		if (requests[r].sameAs >= 0) {
+			requests[r].solutions = requests[requests[r].sameAs].solutions;
+			strcpy(requests[r].solution, requests[requests[r].sameAs].solution);
+		}
+	}
+}
+
+/* The work loop of one solver thread of the solve service, arg is the shared BatchSolver.
+ * For each batch the thread takes requests until none are left, checking each board and counting its
+ * solutions up to 2, or finding them in the cache.
+ */
+int batchSolverThread(void* arg) {
+	BatchSolver* solver = (BatchSolver*)arg;
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int solution[GRID_WIDTH][GRID_WIDTH];
+	int batchDone = 0;
+
+	buildRules(VARIANT);
+	for (;;) {
+		mtx_lock(&solver->lock);
+		while (solver->batch == batchDone && !solver->stopping) {
+			cnd_wait(&solver->started, &solver->lock);
+		}
+		if (solver->stopping) {
+			mtx_unlock(&solver->lock);
+			return 0;
+		}
+		batchDone = solver->batch;
+		mtx_unlock(&solver->lock);
+
+		int r;
+		while ((r = atomic_fetch_add(&solver->nextRequest, 1)) < solver->requestCount) {
+			SolveRequest* request = &solver->requests[r];
+			if (request->sameAs >= 0 || request->solutions < 0) {
+				continue;
+			}
+			int valid = parseBoard(request->board, board);
+			for (int cell = 0; valid && cell < GRID_CELLS; cell++) {
+				int value = (&board[0][0])[cell];
+				valid = value == EMPTY || (candidateMask(board, cell % GRID_WIDTH, cell / GRID_WIDTH) & ((DigitMask)1 << value));
+			}
+			if (!valid) {
+				request->solutions = -1;
+				continue;
+			}
+			if (solver->cache == NULL) {
+				request->solutions = countSolutions(board, solution, 2);
+				if (request->solutions > 0) {
+					formatBoard(solution, request->solution);
+				}
+				else {
+					request->solution[0] = '\0';  // No solution to show
+				}
+				continue;
+			}
+
+			// Look for the puzzle in canonical form, its solution is kept in the same form
+			char key[GRID_CELLS + 1];
+			char canonical[GRID_CELLS + 1] = "";
+			int symmetry, relabel[SIZE + 1];
+			unsigned long long hash = canonicalForm(board, key, &symmetry, relabel);
+			if (!cacheLookup(solver->cache, hash, key, &request->solutions, canonical)) {
+				request->solutions = countSolutions(board, solution, 2);
+				if (request->solutions > 0) {
+					toCanonical(solution, symmetry, relabel, canonical);
+				}
+				cacheStore(solver->cache, hash, key, request->solutions, canonical);
+			}
+			else if (request->solutions > 0) {
+				fromCanonical(canonical, symmetry, relabel, solution);
+			}
+			if (request->solutions > 0) {
+				formatBoard(solution, request->solution);
+			}
+			else {
+				request->solution[0] = '\0';  // A cached unsolvable puzzle leaves solution unset
+			}
+		}
+
+		mtx_lock(&solver->lock);
+		if (--solver->working == 0) {
+			cnd_signal(&solver->finished);
+		}
+		mtx_unlock(&solver->lock);
+	}
+}
+
+/* Make the units a coordinator hands out until the run is done. Arguments: <socket> [gridThreads digThreads gradeThreads]
+ * Each unit is made by a pipeline writing straight to the coordinator, see runCoordinator().
+ *
+ * Returns 0 when the coordinator says the run is done or goes away, 1 if it can't be reached
+ */
+int runWorker(int argc, char* argv[]) {
+	static Pipeline pipeline;
+	struct sockaddr_un address;
+	char line[128];
+	int gridThreads = argc > 1 ? atoi(argv[1]) : 1;
+	int digThreads = argc > 2 ? atoi(argv[2]) : 1;
+	int gradeThreads = argc > 3 ? atoi(argv[3]) : 1;
+	int unit, firstIndex, lastIndex;
+
+	if (argc < 1 || strlen(argv[0]) >= sizeof(address.sun_path) || gridThreads < 1 || digThreads < 1
+		|| gradeThreads < 1 || gridThreads + digThreads + gradeThreads + 2 > MAX_THREADS) {
+		fprintf(stderr, "Usage: work <socket> [gridThreads digThreads gradeThreads]\n");
+		return 1;
+	}
+	if (VARIANT == KILLER || !buildRules(VARIANT)) {
+		fprintf(stderr, "Workers can't make puzzles of this variant and size\n");
+		return 1;
+	}
+
+	int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, argv[0]);
+	if (connection < 0 || connect(connection, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "Can't connect to the coordinator at %s\n", argv[0]);
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	FILE* fromCoordinator = fdopen(dup(connection), "r");
+	FILE* toCoordinator = fdopen(connection, "w");
+
+	pipeline.quiet = TRUE;
+	pipeline.output = toCoordinator;
+	pipeline.shardCount = 1;
+	for (;;) {
+		fprintf(toCoordinator, "next\n");
+		fflush(toCoordinator);
+		if (fgets(line, sizeof(line), fromCoordinator) == NULL || strncmp(line, "done", 4) == 0) {
+			break;
+		}
+		if (strncmp(line, "wait", 4) == 0) {
+			sleep(1);  // Every unit is taken, one may come back from a worker that failed
+			continue;
+		}
+		if (sscanf(line, "unit %d %d %d %llu", &unit, &firstIndex, &lastIndex, &pipeline.seed) != 4) {
+			break;
+		}
+		pipeline.shardId = firstIndex;
+		pipeline.count = lastIndex - firstIndex + 1;
+		if (executePipeline(&pipeline, gridThreads, digThreads, gradeThreads) != 0) {
+			break;
+		}
+		fprintf(toCoordinator, "finished %d\n", unit);
+	}
+	fclose(fromCoordinator);
+	fclose(toCoordinator);
+	return 0;
+}
+
+/* Make puzzles with a pipeline and publish them to a ring in POSIX shared memory for other processes.
+ * Arguments: <name> <consumers> <count> [gridThreads digThreads gradeThreads [seed]]
+ * The ring (see SharedRing) is created afresh under the name with the cursors of consumers consumers, numbered
+ * 0 ... consumers - 1, each starting at the first puzzle. Puzzles go into the ring in index order exactly as
+ * runPipeline() would write them, but packed and without any text. Once the ring is full the publisher waits
+ * for the slowest consumer, so every consumer sees every puzzle even if it starts late or restarts.
+ * The ring is left for the consumers after the run, the last consumer to finish removes it.
+ *
+ * Returns 0 when done, 1 for bad arguments or if the shared memory can't be made
+ */
+int runPublish(int argc, char* argv[]) {
+	static Pipeline pipeline;
+	int consumers = argc > 1 ? atoi(argv[1]) : 0;
+	int gridThreads = argc > 3 ? atoi(argv[3]) : 1;
+	int digThreads = argc > 4 ? atoi(argv[4]) : 2;
+	int gradeThreads = argc > 5 ? atoi(argv[5]) : 1;
+
+	if (argc < 3 || consumers < 1 || consumers > MAX_CONSUMERS || atoi(argv[2]) < 1 || gridThreads < 1
+		|| digThreads < 1 || gradeThreads < 1 || gridThreads + digThreads + gradeThreads + 2 > MAX_THREADS) {
+		fprintf(stderr, "Usage: publish <name> <consumers 1-%d> <count> [gridThreads digThreads gradeThreads [seed]]\n",
+			MAX_CONSUMERS);
+		return 1;
+	}
+	if (VARIANT == KILLER || !buildRules(VARIANT)) {
+		fprintf(stderr, "Puzzles of this variant and size can't be published\n");
+		return 1;
+	}
+	SharedRing* ring = openSharedRing(argv[0], TRUE);
+	if (ring == NULL) {
+		return 1;
+	}
+	ring->consumers = consumers;
+	atomic_store(&ring->finishedConsumers, 0);
+	for (int c = 0; c < MAX_CONSUMERS; c++) {
+		atomic_store(&ring->cursors[c].next, 0);
+		atomic_store(&ring->cursors[c].finished, FALSE);
+	}
+
+	pipeline.count = atoi(argv[2]);
+	pipeline.seed = argc > 6 ? strtoull(argv[6], NULL, 0) : randomState;
+	pipeline.shardId = 0;
+	pipeline.shardCount = 1;
+	pipeline.shared = ring;
+	int result = executePipeline(&pipeline, gridThreads, digThreads, gradeThreads);
+	atomic_store(&ring->total, atomic_load(&ring->published));
+	munmap(ring, sizeof(SharedRing) + SHARED_RING_SLOTS * sizeof(SharedPuzzle));
+	return result;
+}
+
+/* Read the puzzles published to a shared memory ring as one of its consumers. Arguments: <name> <consumer>
+ * Each puzzle is read in place from the ring and written to stdout as the pipeline writes it: index grade
+ * clues board. The consumer's cursor lives in the ring, so a consumer that is stopped and run again carries
+ * on from the first puzzle it had not finished with.
+ *
+ * Returns 0 once every puzzle of the run has been read, 1 if the ring can't be opened
+ */
+int runConsume(int argc, char* argv[]) {
+	int board[GRID_WIDTH][GRID_WIDTH];
+	char text[GRID_CELLS + 1];
+	int consumer = argc > 1 ? atoi(argv[1]) : -1;
+	int spins = 0;
+
+	if (argc < 2 || !buildRules(VARIANT)) {
+		fprintf(stderr, "Usage: consume <name> <consumer>\n");
+		return 1;
+	}
+	SharedRing* ring = openSharedRing(argv[0], FALSE);
+	if (ring == NULL) {
+		return 1;
+	}
+	if (consumer < 0 || consumer >= ring->consumers) {
+		fprintf(stderr, "The ring %s has consumers 0 to %d\n", argv[0], ring->consumers - 1);
+		return 1;
+	}
+
+	ConsumerCursor* cursor = &ring->cursors[consumer];
+	long long next = atomic_load(&cursor->next);
+	for (;;) {
+		SharedPuzzle* puzzle = &ring->slots[next & (ring->slotCount - 1)];
+		if (atomic_load_explicit(&puzzle->sequence, memory_order_acquire) != next + 1) {
+			// Not written yet. Hand back the slots read so far once their lines are out of the stdout buffer,
+			// so that a consumer that is killed reads again just the puzzles it hadn't written
+			if (atomic_load_explicit(&cursor->next, memory_order_relaxed) != next) {
+				fflush(stdout);
+				atomic_store_explicit(&cursor->next, next, memory_order_release);
+			}
+			long long total = atomic_load(&ring->total);
+			if (total >= 0 && next >= total) {
+				break;
+			}
+			backOff(&spins);
+			continue;
+		}
+		spins = 0;
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			(&board[0][0])[cell] = puzzle->cells[cell];
+		}
+		formatBoard(board, text);
+		printf("%d %s %d %s\n", puzzle->index, gradeNames[puzzle->grade], puzzle->clues, text);
+		if (++next % CONSUMER_BATCH == 0) {
+			fflush(stdout);
+			atomic_store_explicit(&cursor->next, next, memory_order_release);
+		}
+	}
+
+	// Counted once per consumer, even if a finished consumer is run again
+	if (!atomic_exchange(&cursor->finished, TRUE)
+		&& atomic_fetch_add(&ring->finishedConsumers, 1) + 1 == ring->consumers) {
+		shm_unlink(argv[0]);
+	}
+	munmap(ring, sizeof(SharedRing) + ring->slotCount * sizeof(SharedPuzzle));
+	return 0;
+}
+
+/* Map the shared memory ring of a name (such as /sudoku). create makes a new empty ring in place of any old
+ * one, otherwise the ring must exist and have been made by a build of the same size and variant.
+ *
+ * Returns the ring, or NULL (with a message) if it can't be mapped
+ */
+SharedRing* openSharedRing(const char* name, int create) {
+	size_t bytes = sizeof(SharedRing) + SHARED_RING_SLOTS * sizeof(SharedPuzzle);
+
+	if (create) {
+		shm_unlink(name);
+	}
+	struct stat status;
+	int descriptor = shm_open(name, create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+	if (descriptor < 0 || (create && ftruncate(descriptor, (off_t)bytes) != 0)
+		|| fstat(descriptor, &status) != 0 || status.st_size != (off_t)bytes) {
+		fprintf(stderr, "Can't %s the shared memory %s\n", create ? "make" : "open", name);
+		if (descriptor >= 0) {
+			close(descriptor);
+		}
+		return NULL;
+	}
+	SharedRing* ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (ring == MAP_FAILED) {
+		fprintf(stderr, "Can't map the shared memory %s\n", name);
+		return NULL;
+	}
+
+	if (create) {
+		// A new object is all zeros, so every slot starts with sequence 0 and no puzzle
+		ring->size = SIZE;
+		ring->variant = VARIANT;
+		ring->slotCount = SHARED_RING_SLOTS;
+		atomic_store(&ring->published, 0);
+		atomic_store(&ring->total, -1);
+		atomic_thread_fence(memory_order_release);
+		ring->magic = SHARED_RING_MAGIC;
+	}
+	else if (ring->magic != SHARED_RING_MAGIC || ring->size != SIZE || ring->variant != VARIANT
+		|| ring->slotCount != SHARED_RING_SLOTS) {
+		fprintf(stderr, "The shared memory %s is not a ring of puzzles from this build\n", name);
+		munmap(ring, bytes);
+		return NULL;
+	}
+	return ring;
+}
+
+/* Write the next puzzle into a shared memory ring, first waiting for every consumer to finish with the puzzle
+ * that held its slot. Only the publisher's writer thread calls it.
+ */
+void sharedPublish(SharedRing* ring, int index, int grade, int clues, int board[][GRID_WIDTH]) {
+	long long number = atomic_load_explicit(&ring->published, memory_order_relaxed);
+	SharedPuzzle* puzzle = &ring->slots[number & (ring->slotCount - 1)];
+	int spins = 0;
+
+	for (int c = 0; c < ring->consumers; c++) {
+		while (atomic_load_explicit(&ring->cursors[c].next, memory_order_acquire) <= number - ring->slotCount) {
+			backOff(&spins);
+		}
+	}
+
+	puzzle->index = index;
+	puzzle->grade = grade;
+	puzzle->clues = clues;
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		puzzle->cells[cell] = (unsigned char)(&board[0][0])[cell];
+	}
+	atomic_store_explicit(&puzzle->sequence, number + 1, memory_order_release);
+	atomic_store_explicit(&ring->published, number + 1, memory_order_release);
+}
+
+/* Wait a little for another process: yield at first, then sleep so that a long wait doesn't hold a core */
+void backOff(int* spins) {
+	if ((*spins)++ < 1000) {
+		thrd_yield();
+	}
+	else {
+		thrd_sleep(&(struct timespec){ .tv_nsec = 100000 }, NULL);
+	}
+}
+
+/* Keep generated puzzles in a store on disk and hand them out by kind. Arguments:
+ *     <directory> add [file...]
+ *     <directory> take <tenant> <grade> <clues or minClues-maxClues> [symmetry [count]]
+ * add appends the puzzles of files (or stdin) written by the pipeline, order or merge, one per line as
+ * index grade clues board, to the data file puzzles.dat, leaving out puzzles already in the store, and then
+ * extends the index file index.dat. Adds running at once wait for each other, takes may run alongside them.
+ * take writes count (1) puzzles of the grade, clues and symmetry (none, mirror, rotational, quarter, or any,
+ * the default) as: record grade clues symmetry board. The index lists the puzzles of each grade, clue count and
+ * symmetry in a random order, and each tenant has a file <tenant>.cursor in the directory holding how far it
+ * has got through every list, so taking a puzzle is a single atomic increment in a mapped file and no tenant is
+ * given the same puzzle twice, even by takes running at once.
+ *
+ * Returns 0 when done, 1 for bad arguments or a store that can't be used, 2 if take found no unused puzzle
+ */
+int runStore(int argc, char* argv[]) {
+	if (argc >= 2 && strcmp(argv[1], "add") == 0 && buildRules(VARIANT)) {
+		return storeAdd(argv[0], argc - 2, argv + 2);
+	}
+	if (argc >= 5 && strcmp(argv[1], "take") == 0 && buildRules(VARIANT)) {
+		return storeTake(argv[0], argc - 2, argv + 2);
+	}
+	fprintf(stderr, "Usage: store <directory> add [file...]\n"
+		"       store <directory> take <tenant> <grade> <clues or minClues-maxClues> [symmetry [count]]\n");
+	return 1;
+}
+
+/* Append puzzles to a store and index them, see runStore(). The lists of the old index keep their order and
+ * the new puzzles are shuffled onto their ends, so the cursors of the tenants stay good. The data file is
+ * locked for the whole add, index included, so a second add waits and then reads what the first one added.
+ */
+int storeAdd(const char* directory, int fileCount, char* files[]) {
+	char path[MAX_PATH_LENGTH + 32];
+	char line[GRID_CELLS + 128];
+	StoreHeader header = { STORE_MAGIC, SIZE, VARIANT, (int)sizeof(StoredPuzzle) };
+	StoredPuzzle record;
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int skipped = 0;
+	int status = 1;  // Until the add is complete
+
+	// Everything the add holds, released on every way out at done
+	FILE* data = NULL;
+	FILE* input = NULL;
+	StoredPuzzle* records = NULL;
+	unsigned long long* seen = NULL;
+	unsigned int* seenRecords = NULL;
+	StoreIndex* oldIndex = NULL;
+	size_t oldBytes = 0;
+	StoreIndex* index = NULL;
+
+	if (strlen(directory) > MAX_PATH_LENGTH) {
+		fprintf(stderr, "The directory name is too long\n");
+		return 1;
+	}
+	sprintf(path, "%s/puzzles.dat", directory);
+	int descriptor = open(path, O_RDWR | O_CREAT, 0644);  // Created empty if missing, never truncated
+	data = descriptor >= 0 ? fdopen(descriptor, "r+b") : NULL;
+	if (data == NULL && descriptor >= 0) {
+		close(descriptor);
+	}
+	if (data == NULL || flock(descriptor, LOCK_EX) != 0) {
+		fprintf(stderr, "Can't open %s\n", path);
+		goto done;
+	}
+
+	// Check the data file and read the puzzles already in it, dropping a record cut short by a failed add
+	StoreHeader found;
+	fseek(data, 0, SEEK_END);
+	long length = ftell(data);
+	rewind(data);
+	if (length == 0) {
+		fwrite(&header, sizeof(header), 1, data);
+		length = sizeof(header);
+	}
+	else if (fread(&found, sizeof(found), 1, data) != 1 || memcmp(&found, &header, sizeof(header)) != 0) {
+		fprintf(stderr, "%s is not a store of this build\n", path);
+		goto done;
+	}
+	unsigned int oldRecords = (unsigned int)((length - (long)sizeof(header)) / (long)sizeof(StoredPuzzle));
+	truncateFile(data, (long)sizeof(header) + (long)oldRecords * (long)sizeof(StoredPuzzle));
+
+	// Hashes of every board in the store with the record holding it, to leave out those added before
+	unsigned int capacity = oldRecords;
+	records = malloc((capacity + 1) * sizeof(StoredPuzzle));
+	int seenSize = 1024;
+	while ((unsigned int)seenSize < 2 * (oldRecords + 1)) {
+		seenSize *= 2;
+	}
+	seen = calloc(seenSize, sizeof(unsigned long long));
+	seenRecords = malloc(seenSize * sizeof(unsigned int));
+	if (records == NULL || seen == NULL || seenRecords == NULL || fread(records, sizeof(StoredPuzzle), oldRecords, data) != oldRecords) {
+		fprintf(stderr, "Can't read %s\n", path);
+		goto done;
+	}
+	unsigned int recordCount = oldRecords;
+	for (unsigned int r = 0; r < recordCount; r++) {
+		unsigned long long hash = hashText(records[r].board) | 1;
+		int slot = (int)(hash & (seenSize - 1));
+		while (seen[slot] != 0) {
+			slot = (slot + 1) & (seenSize - 1);
+		}
+		seen[slot] = hash;
+		seenRecords[slot] = r;
+	}
+
+	fseek(data, 0, SEEK_END);
+	for (int f = 0; f < (fileCount > 0 ? fileCount : 1); f++) {
+		input = fileCount > 0 ? fopen(files[f], "r") : stdin;
+		if (input == NULL) {
+			fprintf(stderr, "Can't read %s\n", files[f]);
+			continue;
+		}
+		while (fgets(line, sizeof(line), input) != NULL) {
+			char gradeName[16];
+			char format[48];
+			int index, clues, grade = -1;
+			sprintf(format, "%%d %%15s %%d %%%ds", GRID_CELLS);
+			memset(&record, 0, sizeof(record));
+			if (sscanf(line, format, &index, gradeName, &clues, record.board) != 4 || !parseBoard(record.board, board)) {
+				skipped++;  // A header, trailer or line that isn't a puzzle of this build
+				continue;
+			}
+			for (int g = 0; g < GRADES; g++) {
+				if (strcmp(gradeName, gradeNames[g]) == 0) {
+					grade = g;
+				}
+			}
+			int counted = 0;
+			for (int cell = 0; cell < GRID_CELLS; cell++) {
+				counted += rules.active[cell] && (&board[0][0])[cell] != EMPTY;
+			}
+			if (grade < 0 || counted != clues) {
+				skipped++;
+				continue;
+			}
+
+			// A board with the same hash is only the same board if its text is too
+			unsigned long long hash = hashText(record.board) | 1;
+			int slot = (int)(hash & (seenSize - 1));
+			while (seen[slot] != 0 && (seen[slot] != hash || strcmp(records[seenRecords[slot]].board, record.board) != 0)) {
+				slot = (slot + 1) & (seenSize - 1);
+			}
+			if (seen[slot] != 0) {
+				skipped++;
+				continue;
+			}
+			seen[slot] = hash;
+			seenRecords[slot] = recordCount;
+
+			record.grade = (unsigned char)grade;
+			record.clues = (unsigned short)clues;
+			record.symmetry = (unsigned char)symmetryClass(board);
+			if (recordCount == capacity) {
+				StoredPuzzle* grown = realloc(records, (capacity * 2 + 1024 + 1) * sizeof(StoredPuzzle));
+				if (grown == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					goto done;
+				}
+				records = grown;
+				capacity = capacity * 2 + 1024;
+			}
+			if (fwrite(&record, sizeof(record), 1, data) != 1) {
+				fprintf(stderr, "Can't add to %s\n", path);
+				goto done;
+			}
+			records[recordCount++] = record;
+
+			// Keep the table of hashes at most half full
+			if (2 * (recordCount + 1) > (unsigned int)seenSize) {
+				unsigned long long* grown = calloc(2 * (size_t)seenSize, sizeof(unsigned long long));
+				unsigned int* grownRecords = malloc(2 * (size_t)seenSize * sizeof(unsigned int));
+				if (grown == NULL || grownRecords == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					free(grown);
+					free(grownRecords);
+					goto done;
+				}
+				for (int i = 0; i < seenSize; i++) {
+					if (seen[i] != 0) {
+						int to = (int)(seen[i] & (2 * seenSize - 1));
+						while (grown[to] != 0) {
+							to = (to + 1) & (2 * seenSize - 1);
+						}
+						grown[to] = seen[i];
+						grownRecords[to] = seenRecords[i];
+					}
+				}
+				free(seen);
+				free(seenRecords);
+				seen = grown;
+				seenRecords = grownRecords;
+				seenSize *= 2;
+			}
+		}
+		if (input != stdin) {
+			fclose(input);
+		}
+		input = NULL;
+	}
+	if (fflush(data) != 0) {
+		fprintf(stderr, "Can't add to %s\n", path);
+		goto done;
+	}
+
+	// The new index: each bucket is its old list followed by its new puzzles shuffled
+	sprintf(path, "%s/index.dat", directory);
+	oldIndex = mapFile(path, &oldBytes, FALSE);
+	const unsigned int* oldStarts = NULL;
+	if (oldIndex != NULL && (memcmp(&oldIndex->header, &header, sizeof(header)) != 0 || oldIndex->records > oldRecords
+		|| oldIndex->bucketCount != STORE_BUCKETS)) {
+		fprintf(stderr, "%s is not the index of this store\n", path);
+		goto done;
+	}
+	unsigned int indexed = oldIndex != NULL ? oldIndex->records : 0;
+	if (oldIndex != NULL) {
+		oldStarts = (const unsigned int*)(oldIndex + 1);
+	}
+
+	size_t bytes = sizeof(StoreIndex) + (STORE_BUCKETS + 1 + (size_t)recordCount) * sizeof(unsigned int);
+	index = calloc(1, bytes);
+	if (index == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		goto done;
+	}
+	index->header = header;
+	index->records = recordCount;
+	index->bucketCount = STORE_BUCKETS;
+	unsigned int* starts = (unsigned int*)(index + 1);
+	unsigned int* entries = starts + STORE_BUCKETS + 1;
+	for (unsigned int r = 0; r < recordCount; r++) {
+		starts[storeBucket(records[r].grade, records[r].clues, records[r].symmetry) + 1]++;
+	}
+	for (int b = 0; b < STORE_BUCKETS; b++) {
+		starts[b + 1] += starts[b];
+	}
+	for (int b = 0; b < STORE_BUCKETS; b++) {
+		unsigned int next = starts[b];
+		if (oldIndex != NULL) {
+			const unsigned int* oldEntries = oldStarts + STORE_BUCKETS + 1;
+			for (unsigned int e = oldStarts[b]; e < oldStarts[b + 1]; e++) {
+				entries[next++] = oldEntries[e];
+			}
+		}
+		unsigned int first = next;
+		for (unsigned int r = indexed; r < recordCount; r++) {
+			if (storeBucket(records[r].grade, records[r].clues, records[r].symmetry) == b) {
+				entries[next++] = r;
+			}
+		}
+		for (unsigned int e = next; e > first + 1; e--) {
+			unsigned int swap = first + (unsigned int)randomInt((int)(e - first));
+			unsigned int value = entries[e - 1];
+			entries[e - 1] = entries[swap];
+			entries[swap] = value;
+		}
+	}
+
+	// Written under a temporary name and renamed over the old index, so a take always maps a whole index
+	char temporaryPath[MAX_PATH_LENGTH + 36];
+	sprintf(temporaryPath, "%s.tmp", path);
+	FILE* indexFile = fopen(temporaryPath, "wb");
+	int written = indexFile != NULL && fwrite(index, bytes, 1, indexFile) == 1;
+	written = indexFile != NULL && fclose(indexFile) == 0 && written;
+	if (!written || rename(temporaryPath, path) != 0) {
+		fprintf(stderr, "Can't write %s\n", path);
+		goto done;
+	}
+	fprintf(stderr, "%u puzzles added, %u in the store, %d lines left out\n", recordCount - oldRecords, recordCount,
+		skipped);
+	status = 0;
+
+done:
+	if (input != NULL && input != stdin) {
+		fclose(input);
+	}
+	if (oldIndex != NULL) {
+		munmap(oldIndex, oldBytes);
+	}
+	if (data != NULL) {
+		fclose(data);  // Lets the next add in
+	}
+	free(index);
+	free(seen);
+	free(seenRecords);
+	free(records);
+	return status;
+}
+
+/* Hand out unused puzzles of a kind to a tenant, see runStore(). A list of the kind is picked with chances in
+ * proportion to the puzzles left in it for the tenant, and the tenant's cursor of that list moved on by one.
+ */
+int storeTake(const char* directory, int argc, char* argv[]) {
+	char path[MAX_PATH_LENGTH + 64];
+	StoredPuzzle record;
+	int grade = -1, minClues, maxClues;
+	int symmetry = argc > 3 ? -1 : SYMMETRY_CLASSES;  // SYMMETRY_CLASSES for any
+	int wanted = argc > 4 ? atoi(argv[4]) : 1;
+	size_t indexBytes, cursorBytes;
+	int taken = 0;
+
+	for (int g = 0; g < GRADES; g++) {
+		if (strcmp(argv[1], gradeNames[g]) == 0) {
+			grade = g;
+		}
+	}
+	if (sscanf(argv[2], "%d-%d", &minClues, &maxClues) == 1) {
+		maxClues = minClues;
+	}
+	for (int c = 0; c < SYMMETRY_CLASSES && argc > 3; c++) {
+		if (strcmp(argv[3], symmetryNames[c]) == 0) {
+			symmetry = c;
+		}
+	}
+	if (argc > 3 && strcmp(argv[3], "any") == 0) {
+		symmetry = SYMMETRY_CLASSES;
+	}
+	int validTenant = argv[0][0] != '\0' && strlen(argv[0]) <= 32;
+	for (const char* c = argv[0]; *c; c++) {
+		validTenant &= (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_';
+	}
+	if (!validTenant || grade < 0 || minClues < 0 || minClues > maxClues || maxClues > GRID_CELLS || symmetry < 0
+		|| wanted < 1 || strlen(directory) > MAX_PATH_LENGTH) {
+		fprintf(stderr, "Usage: store <directory> take <tenant> <easy|medium|hard> <clues or minClues-maxClues> "
+			"[none|mirror|rotational|quarter|any [count]]\nTenant names are letters, digits, - and _\n");
+		return 1;
+	}
+
+	sprintf(path, "%s/index.dat", directory);
+	StoreIndex* index = mapFile(path, &indexBytes, FALSE);
+	StoreHeader header = { STORE_MAGIC, SIZE, VARIANT, (int)sizeof(StoredPuzzle) };
+	if (index == NULL || memcmp(&index->header, &header, sizeof(header)) != 0 || index->bucketCount != STORE_BUCKETS) {
+		fprintf(stderr, "%s is not the index of a store of this build\n", path);
+		return 1;
+	}
+	const unsigned int* starts = (const unsigned int*)(index + 1);
+	const unsigned int* entries = starts + STORE_BUCKETS + 1;
+
+	sprintf(path, "%s/%s.cursor", directory, argv[0]);
+	atomic_uint* cursors = mapFile(path, &cursorBytes, TRUE);
+	if (cursors == NULL) {
+		// A new tenant, starting at the front of every list. An existing file is never replaced
+		int descriptor = open(path, O_RDWR | O_CREAT, 0600);
+		int made = descriptor >= 0 && ftruncate(descriptor, STORE_BUCKETS * sizeof(atomic_uint)) == 0;
+		if (descriptor >= 0) {
+			close(descriptor);
+		}
+		cursors = made ? mapFile(path, &cursorBytes, TRUE) : NULL;
+	}
+	if (cursors == NULL || cursorBytes != STORE_BUCKETS * sizeof(atomic_uint)) {
+		fprintf(stderr, "Can't use the cursors %s\n", path);
+		return 1;
+	}
+
+	sprintf(path, "%s/puzzles.dat", directory);
+	int data = open(path, O_RDONLY);
+	while (data >= 0 && taken < wanted) {
+		long long left = 0;
+		for (int clues = minClues; clues <= maxClues; clues++) {
+			for (int c = 0; c < SYMMETRY_CLASSES; c++) {
+				int b = storeBucket(grade, clues, c);
+				unsigned int used = atomic_load(&cursors[b]);
+				left += (symmetry == SYMMETRY_CLASSES || symmetry == c) && used < starts[b + 1] - starts[b]
+					? starts[b + 1] - starts[b] - used : 0;
+			}
+		}
+		if (left == 0) {
+			break;
+		}
+
+		long long pick = randomInt(left > 0x7FFFFFFF ? 0x7FFFFFFF : (int)left);
+		for (int clues = minClues; clues <= maxClues && pick >= 0; clues++) {
+			for (int c = 0; c < SYMMETRY_CLASSES && pick >= 0; c++) {
+				int b = storeBucket(grade, clues, c);
+				unsigned int used = atomic_load(&cursors[b]);
+				unsigned int count = starts[b + 1] - starts[b];
+				if ((symmetry != SYMMETRY_CLASSES && symmetry != c) || used >= count) {
+					continue;
+				}
+				pick -= count - used;
+				if (pick >= 0) {
+					continue;
+				}
+				// Another take may have moved the cursor meanwhile, then the list is picked again
+				unsigned int position = atomic_fetch_add(&cursors[b], 1);
+				if (position < count && pread(data, &record, sizeof(record),
+					(off_t)sizeof(StoreHeader) + (off_t)entries[starts[b] + position] * (off_t)sizeof(record)) == sizeof(record)) {
+					printf("%u %s %d %s %s\n", entries[starts[b] + position], gradeNames[record.grade], record.clues,
+						symmetryNames[record.symmetry], record.board);
+					taken++;
+				}
+			}
+		}
+	}
+	if (data < 0) {
+		fprintf(stderr, "Can't read %s\n", path);
+	}
+	else {
+		close(data);
+	}
+	munmap(cursors, cursorBytes);
+	munmap(index, indexBytes);
+	if (taken < wanted) {
+		fprintf(stderr, "Only %d unused puzzles of that kind for %s\n", taken, argv[0]);
+	}
+	return data < 0 ? 1 : taken < wanted ? 2 : 0;
+}
+
+/* The bucket of a store index holding the puzzles of a grade, clue count and symmetry class */
+int storeBucket(int grade, int clues, int symmetry) {
+	return (grade * (GRID_CELLS + 1) + clues) * SYMMETRY_CLASSES + symmetry;
+}
+
+/* Find the strongest symmetry of the pattern of clues of a puzzle, among those that keep the rules.
+ * Returns NO_SYMMETRY, MIRROR, ROTATIONAL or QUARTER
+ */
+int symmetryClass(int board[][GRID_WIDTH]) {
+	const int* cells = &board[0][0];
+	int strongest = NO_SYMMETRY;
+
+	for (int s = 1; s < rules.symmetryCount; s++) {
+		int keeps = TRUE;
+		for (int cell = 0; keeps && cell < GRID_CELLS; cell++) {
+			keeps = (cells[cell] == EMPTY) == (cells[rules.symmetries[s][cell]] == EMPTY);
+		}
+		// See buildSymmetries(): 3 reflects both ways, a half turn, and 5 and 6 reflect and transpose, a quarter turn
+		int kind = rules.symmetryKinds[s];
+		int symmetry = kind == 3 ? ROTATIONAL : (kind == 5 || kind == 6) ? QUARTER : MIRROR;
+		if (keeps && symmetry > strongest) {
+			strongest = symmetry;
+		}
+	}
+	return strongest;
+}
+
+/* Map a whole file into memory, shared with other processes if writable.
+ * Returns the mapping with its length in bytes, or NULL if the file can't be opened or is empty
+ */
+void* mapFile(const char* path, size_t* bytes, int writable) {
+	struct stat status;
+	int descriptor = open(path, writable ? O_RDWR : O_RDONLY);
+	void* mapping = NULL;
+
+	if (descriptor >= 0 && fstat(descriptor, &status) == 0 && status.st_size > 0) {
+		*bytes = (size_t)status.st_size;
+		mapping = mmap(NULL, *bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+		if (mapping == MAP_FAILED) {
+			mapping = NULL;
+		}
+	}
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+	return mapping;
+}
+
+/* Solve every board of a file. Arguments: <file> [threads [parse]]
+ * The file holds a board per line, either alone or last on the line as in pipeline output. It is mapped into
+ * memory and split into chunks of about CHUNK_BYTES that begin and end at line ends, and the threads take the
+ * chunks in turn. The boards are read in place from the mapping, GRID_CELLS characters at a time by
+ * parseCells(), and each answer goes to stdout in the order of the file, one line per board as from the solve
+ * service (see runService()). With parse the boards are only read and checked, to measure the input side.
+ *
+ * Returns 0 when done, 1 for bad arguments or if the file can't be mapped
+ */
+int runSolveFile(int argc, char* argv[]) {
+	static BoardFile file;
+	thrd_t threads[MAX_THREADS];
+	int threadCount = argc > 1 ? atoi(argv[1]) : 1;
+
+	if (argc < 1 || threadCount < 1 || threadCount > MAX_THREADS || (argc > 2 && strcmp(argv[2], "parse") != 0)) {
+		fprintf(stderr, "Usage: solve <file> [threads 1-%d [parse]]\n", MAX_THREADS);
+		return 1;
+	}
+	if (VARIANT == KILLER || !buildRules(VARIANT)) {
+		fprintf(stderr, "Boards of this variant and size can't be solved from a file\n");
+		return 1;
+	}
+	file.text = mapFile(argv[0], &file.length, FALSE);
+	if (file.text == NULL) {
+		fprintf(stderr, "Can't map %s\n", argv[0]);
+		return 1;
+	}
+	madvise((void*)file.text, file.length, MADV_SEQUENTIAL);  // Read ahead of the threads
+
+	file.parseOnly = argc > 2;
+	file.chunkCount = (int)((file.length + CHUNK_BYTES - 1) / CHUNK_BYTES);
+	file.answers = calloc(file.chunkCount, sizeof(char*));
+	file.answerLengths = calloc(file.chunkCount, sizeof(size_t));
+	if (file.answers == NULL || file.answerLengths == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	atomic_init(&file.nextChunk, 0);
+	atomic_init(&file.boards, 0);
+	atomic_init(&file.errors, 0);
+	mtx_init(&file.lock, mtx_plain);
+
+	double start = secondsNow();
+	for (int t = 0; t < threadCount; t++) {
+		thrd_create(&threads[t], boardFileThread, &file);
+	}
+	for (int t = 0; t < threadCount; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	double elapsed = secondsNow() - start;
+	fflush(stdout);
+
+	fprintf(stderr, "%lld boards, %lld not boards of this build, %.1f MB in %.3f s (%.1f MB/s, %.0f boards/s)\n",
+		atomic_load(&file.boards), atomic_load(&file.errors), file.length / 1e6, elapsed,
+		elapsed > 0.0 ? file.length / 1e6 / elapsed : 0.0, elapsed > 0.0 ? atomic_load(&file.boards) / elapsed : 0.0);
+	munmap((void*)file.text, file.length);
+	free(file.answers);
+	free(file.answerLengths);
+	return 0;
+}
+
+/* The work loop of one thread solving a file of boards, arg is the BoardFile.
+ * Takes chunks until none are left, gathering the answers of a chunk in a buffer of its own. The buffers are
+ * written out in chunk order by whichever thread finishes the chunk that is next to be written.
+ */
+int boardFileThread(void* arg) {
+	BoardFile* file = (BoardFile*)arg;
+	const char* fileEnd = file->text + file->length;
+	unsigned char values[GRID_CELLS];
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int solution[GRID_WIDTH][GRID_WIDTH];
+	int* cells = &board[0][0];
+	int chunk;
+
+	buildRules(VARIANT);
+	while ((chunk = atomic_fetch_add(&file->nextChunk, 1)) < file->chunkCount) {
+		const char* line = chunkStart(file, chunk);
+		const char* end = chunkStart(file, chunk + 1);
+		size_t capacity = CHUNK_BYTES / 2 + GRID_CELLS + 32;
+		size_t length = 0;
+		char* answers = malloc(capacity);
+		long long boards = 0, errors = 0;
+
+		while (line < end && answers != NULL) {
+			const char* lineEnd = memchr(line, '\n', (size_t)(fileEnd - line));
+			const char* next = lineEnd != NULL ? lineEnd + 1 : fileEnd;
+			if (lineEnd == NULL) {
+				lineEnd = fileEnd;
+			}
+			while (lineEnd > line && (lineEnd[-1] == '\r' || lineEnd[-1] == ' ' || lineEnd[-1] == '\t')) {
+				lineEnd--;
+			}
+			if (lineEnd == line) {
+				line = next;
+				continue;  // A blank line
+			}
+			if (capacity - length < GRID_CELLS + 32) {
+				capacity *= 2;
+				answers = realloc(answers, capacity);
+				if (answers == NULL) {
+					break;
+				}
+			}
+
+			// The board is the last GRID_CELLS characters of the line, read straight from the mapping
+			const char* text = lineEnd - GRID_CELLS;
+			int valid = text >= line && (text == line || text[-1] == ' ' || text[-1] == '\t') && parseCells(text, values);
+			int misplaced = 0;  // Inactive cells written as active ones or the other way round
+			DigitMask digits[GRID_CELLS];
+			for (int cell = 0; valid && cell < GRID_CELLS; cell++) {
+				int inactive = (values[cell] == INACTIVE_VALUE);
+				misplaced |= (inactive == rules.active[cell]);
+				cells[cell] = inactive ? EMPTY : values[cell];
+				digits[cell] = ((DigitMask)1 << cells[cell]) & ~(DigitMask)1;  // Nothing for EMPTY
+			}
+			valid = valid && !misplaced;
+
+			// No integer given twice in a region: a region has as many integers as givens
+			for (int region = 0; valid && region < rules.regionCount; region++) {
+				DigitMask seen = 0;
+				int givens = 0;
+				for (int k = 0; k < SIZE; k++) {
+					DigitMask digit = digits[rules.regionCells[region][k]];
+					seen |= digit;
+					givens += digit != 0;
+				}
+				valid = countDigits(seen) == givens;
+			}
+			boards++;
+			if (!valid) {
+				errors++;
+				length += sprintf(answers + length, "error not a board of this size and variant\n");
+			}
+			else if (!file->parseOnly) {
+				int solutions = countSolutions(board, solution, 2);
+				length += sprintf(answers + length, "solutions %d", solutions);
+				if (solutions > 0) {
+					answers[length++] = ' ';
+					formatBoard(solution, answers + length);
+					length += GRID_CELLS;
+				}
+				answers[length++] = '\n';
+			}
+			line = next;
+		}
+		if (answers == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		atomic_fetch_add(&file->boards, boards);
+		atomic_fetch_add(&file->errors, errors);
+
+		// Hand the answers over and write out every chunk that is now next in order
+		mtx_lock(&file->lock);
+		file->answers[chunk] = answers;
+		file->answerLengths[chunk] = length;
+		while (file->nextAnswer < file->chunkCount && file->answers[file->nextAnswer] != NULL) {
+			fwrite(file->answers[file->nextAnswer], 1, file->answerLengths[file->nextAnswer], stdout);
+			free(file->answers[file->nextAnswer]);
+			file->answers[file->nextAnswer] = NULL;
+			file->answerLengths[file->nextAnswer] = 0;
+			file->nextAnswer++;
+		}
+		mtx_unlock(&file->lock);
+	}
+	return 0;
+}
+
+/* The first line of a chunk of a file of boards: the line after the first line end at or after the chunk's
+ * share of the file. A line belongs to the chunk it starts in.
+ */
+const char* chunkStart(const BoardFile* file, int chunk) {
+	size_t offset = (size_t)chunk * CHUNK_BYTES;
+
+	if (chunk == 0) {
+		return file->text;
+	}
+	if (offset >= file->length) {
+		return file->text + file->length;
+	}
+	const char* lineEnd = memchr(file->text + offset - 1, '\n', file->length - offset + 1);
+	return lineEnd != NULL ? lineEnd + 1 : file->text + file->length;
+}
+
+/* Read the cells of a board written as text (see cellChars): 0 for an empty cell written as . or 0, the integer
+ * of a filled cell, or INACTIVE_VALUE for INACTIVE_CHAR. With SSE2 16 characters are converted at once by
+ * comparing them with the ranges of digits and letters, the cells left over one at a time.
+ *
+ * Returns FALSE if a character is not one of a board of this size
+ */
+int parseCells(const char* text, unsigned char values[GRID_CELLS]) {
+	int cell = 0;
+	int bad = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i digitLimit = _mm_set1_epi8(SIZE < 10 ? SIZE + 1 : 10);
+	const __m128i letterLimit = _mm_set1_epi8(SIZE + 1);
+	for (; cell + 16 <= GRID_CELLS; cell += 16) {
+		__m128i characters = _mm_loadu_si128((const __m128i*)(text + cell));
+		__m128i digit = _mm_sub_epi8(characters, _mm_set1_epi8('0'));
+		__m128i letter = _mm_sub_epi8(characters, _mm_set1_epi8('A' - 10));
+		__m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)), _mm_cmplt_epi8(digit, digitLimit));
+		__m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8(9)), _mm_cmplt_epi8(letter, letterLimit));
+		__m128i isEmpty = _mm_cmpeq_epi8(characters, _mm_set1_epi8(cellChars[EMPTY]));
+		__m128i isInactive = _mm_cmpeq_epi8(characters, _mm_set1_epi8(INACTIVE_CHAR));
+		__m128i value = _mm_or_si128(_mm_and_si128(digit, isDigit), _mm_and_si128(letter, isLetter));
+		_mm_storeu_si128((__m128i*)(values + cell), _mm_or_si128(value, isInactive));  // All ones is INACTIVE_VALUE
+		bad |= _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(isDigit, isLetter), _mm_or_si128(isEmpty, isInactive))) ^ 0xFFFF;
+	}
+#endif
+	for (; cell < GRID_CELLS; cell++) {
+		char c = text[cell];
+		if (c >= '0' && c <= '9' && c - '0' <= SIZE) {
+			values[cell] = (unsigned char)(c - '0');
+		}
+		else if (c >= 'A' && c - 'A' + 10 <= SIZE) {
+			values[cell] = (unsigned char)(c - 'A' + 10);
+		}
+		else if (c == cellChars[EMPTY]) {
+			values[cell] = EMPTY;
+		}
+		else if (c == INACTIVE_CHAR) {
+			values[cell] = INACTIVE_VALUE;
+		}
+		else {
+			bad = TRUE;
+		}
+	}
+	return !bad;
+}
+
+#else
+
+int runCoordinator(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Coordinator and worker processes talk over Unix domain sockets and are only built for Linux\n");
+	return 1;
+}
+
+int runWorker(int argc, char* argv[]) {
+	return runCoordinator(argc, argv);
+}
+
+int runService(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "The solve service talks over Unix domain sockets and is only built for Linux\n");
+	return 1;
+}
+
+int runPublish(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Shared memory rings of puzzles are only built for Linux\n");
+	return 1;
+}
+
+int runConsume(int argc, char* argv[]) {
+	return runPublish(argc, argv);
+}
+
+int runStore(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Puzzle stores are mapped into memory and are only built for Linux\n");
+	return 1;
+}
+
+int runSolveFile(int argc, char* argv[]) {
+	(void)argc;
+	(void)argv;
+	fprintf(stderr, "Files of boards are mapped into memory and are only solved on Linux\n");
+	return 1;
+}
+
+#endif
+
+/* Find the difficulty grade of a puzzle with a unique solution by solving a copy of it the way a person would.
+ * Cells with a single legal integer are filled first (EASY); when there are none left, an integer that has a
+ * single possible cell in one of the regions is placed (MEDIUM). A puzzle that gets stuck needs harder
+ * techniques or guessing (HARD).
+ *
+ * Returns EASY, MEDIUM or HARD
+ */
+int gradePuzzle(int board[][GRID_WIDTH]) {
+	int work[GRID_WIDTH][GRID_WIDTH];  // The copy being solved
+	int* cells = &work[0][0];
+	int grade = EASY;
+	int progress = TRUE;
+
+	TRACE_BEGIN("gradePuzzle");
+	duplicateBoard(board, work);
+
+	while (progress) {
+		progress = FALSE;
+
+		// Naked singles: cells with only one legal integer
+		for (int cell = 0; cell < GRID_CELLS; cell++) {
+			if (cells[cell] == EMPTY && rules.active[cell]) {
+				DigitMask candidates = candidateMask(work, cell % GRID_WIDTH, cell / GRID_WIDTH);
+				if (countDigits(candidates) == 1) {
+					cells[cell] = countDigits(candidates - 1);  // The bit index is the integer
+					progress = TRUE;
+				}
+			}
+		}
+		if (progress) {
+			continue;
+		}
+
+		// Hidden singles: integers with only one possible cell in a region
+		for (int region = 0; region < rules.regionCount && !progress; region++) {
+			DigitMask seenOnce = 0;
+			DigitMask seenTwice = 0;
+			for (int k = 0; k < SIZE; k++) {
+				int cell = rules.regionCells[region][k];
+				if (cells[cell] == EMPTY) {
+					DigitMask candidates = candidateMask(work, cell % GRID_WIDTH, cell / GRID_WIDTH);
+					seenTwice |= seenOnce & candidates;
+					seenOnce |= candidates;
+				}
+			}
+			DigitMask single = seenOnce & ~seenTwice;
+			if (single) {
+				DigitMask digit = single & (~single + 1);
+				for (int k = 0; k < SIZE && !progress; k++) {
+					int cell = rules.regionCells[region][k];
+					if (cells[cell] == EMPTY && (candidateMask(work, cell % GRID_WIDTH, cell / GRID_WIDTH) & digit)) {
+						cells[cell] = countDigits(digit - 1);
+						grade = MEDIUM;
+						progress = TRUE;
+					}
+				}
+			}
+		}
+	}
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		if (cells[cell] == EMPTY && rules.active[cell]) {
+			grade = HARD;
+		}
+	}
+	TRACE_END();
+	return grade;
+}
+
+/* Count every solution of a board, saving the count as it goes so that it can be stopped and resumed.
+ * Arguments: <board> [threads [checkpointFile [firstUnit-lastUnit]]]
+ * The board is one line of text as written by formatBoard(). It is split into the same units (at least
+ * COUNT_UNITS boards with some more cells filled) every time, and a count can be limited to a range of them
+ * so that several machines can each take a range and add up their results.
+ * Threads take subproblems from a shared list and search each for COUNT_SLICE_NODES nodes, then hand back the
+ * moves still untried as new subproblems. Every CHECKPOINT_SECONDS the solutions so far and the subproblems not
+ * yet finished are saved to the checkpoint file; when the file already exists the count resumes from it, with
+ * any number of threads.
+ * The total is written to stdout as: solutions <count>
+ *
+ * Returns 0 when the count is complete, 1 for bad arguments or an unusable checkpoint
+ */
+int runCount(int argc, char* argv[]) {
+	static SolutionCount count;
+	thrd_t workers[MAX_THREADS];
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int threadCount = argc > 1 ? atoi(argv[1]) : 1;
+
+	if (argc < 1 || threadCount < 1 || threadCount > MAX_THREADS) {
+		fprintf(stderr, "Usage: count <board> [threads 1-%d [checkpointFile [firstUnit-lastUnit]]]\n", MAX_THREADS);
+		return 1;
+	}
+	if (VARIANT == KILLER) {
+		fprintf(stderr, "Counting KILLER boards is not supported, the board text does not hold the cages.\n");
+		return 1;
+	}
+	if (!buildRules(VARIANT)) {
+		fprintf(stderr, "Error, the chosen puzzle variant is not available for a board of size %d.\n", SIZE);
+		return 1;
+	}
+	int valid = parseBoard(argv[0], board);
+	for (int cell = 0; valid && cell < GRID_CELLS; cell++) {
+		int value = (&board[0][0])[cell];
+		// A given must still be a legal integer for its cell, i.e. no peer repeats it
+		valid = value == EMPTY || (candidateMask(board, cell % GRID_WIDTH, cell / GRID_WIDTH) & ((DigitMask)1 << value));
+	}
+	if (!valid) {
+		fprintf(stderr, "The board must be %d characters from \"%s\" (# for unused cells) with no repeats in a region\n",
+			GRID_CELLS, cellChars);
+		return 1;
+	}
+
+	memset(&count, 0, sizeof(count));
+	formatBoard(board, count.board);
+	count.firstUnit = 0;
+	count.lastUnit = -1;  // Every unit
+	if (argc > 3 && sscanf(argv[3], "%d-%d", &count.firstUnit, &count.lastUnit) != 2) {
+		fprintf(stderr, "Bad unit range \"%s\", expected firstUnit-lastUnit\n", argv[3]);
+		return 1;
+	}
+	if (argc > 2) {
+		if (strlen(argv[2]) >= MAX_PATH_LENGTH - 4) {
+			fprintf(stderr, "The checkpoint path is too long\n");
+			return 1;
+		}
+		strcpy(count.checkpointPath, argv[2]);
+	}
+	count.searching = calloc(threadCount, sizeof(*count.searching));
+
+	int resumed = count.checkpointPath[0] ? loadCount(&count) : FALSE;
+	if (resumed < 0) {
+		return 1;
+	}
+	if (!resumed) {
+		// Split the board into units and queue the ones in range, the first unit is searched first
+		char (*units)[GRID_CELLS + 1] = NULL;
+		int unitCount = splitIntoUnits(board, &units);
+		if (unitCount < 0) {
+			fprintf(stderr, "Not enough memory to split the board\n");
+			return 1;
+		}
+		if (count.lastUnit < 0 || count.lastUnit >= unitCount) {
+			count.lastUnit = unitCount - 1;
+		}
+		fprintf(stderr, "%d units, counting units %d-%d\n", unitCount, count.firstUnit, count.lastUnit);
+		for (int u = count.lastUnit; u >= count.firstUnit; u--) {
+			addPending(&count, units[u]);
+		}
+		free(units);
+		if (count.checkpointPath[0]) {
+			saveCount(&count);
+		}
+	}
+
+	double start = secondsNow();
+	mtx_init(&count.lock, mtx_plain);
+	cnd_init(&count.changed);
+	for (int t = 0; t < threadCount; t++) {
+		thrd_create(&workers[t], countWorker, &count);
+	}
+	for (int t = 0; t < threadCount; t++) {
+		thrd_join(workers[t], NULL);
+	}
+	cnd_destroy(&count.changed);
+	mtx_destroy(&count.lock);
+	if (count.failed) {
+		fprintf(stderr, "Not enough memory for the pending subproblems\n");
+		return 1;
+	}
+	if (count.checkpointPath[0]) {
+		saveCount(&count);  // Nothing pending, the checkpoint now records the finished count
+	}
+
+	fprintf(stderr, "%llu nodes in %.3f s\n", count.nodes, secondsNow() - start);
+	printf("solutions %llu\n", count.solutions);
+	free(count.pending);
+	free(count.searching);
+	return 0;
+}
+
+/* The work loop of one thread of runCount(), arg is the shared SolutionCount.
+ * The thread searches in a solver context of its own, kept in a workspace on its stack.
+ */
+int countWorker(void* arg) {
+	SolutionCount* count = (SolutionCount*)arg;
+	alignas(ARENA_ALIGN) unsigned char workspace[SOLVER_WORKSPACE_MAX];
+	int board[GRID_WIDTH][GRID_WIDTH];
+	int solution[GRID_WIDTH][GRID_WIDTH];
+
+	buildRules(VARIANT);
+	SolverContext* solver = solverInit(workspace, sizeof(workspace), GRID_CELLS);
+	solver->nodeLimit = COUNT_SLICE_NODES;
+
+	mtx_lock(&count->lock);
+	int thread = count->nextThread++;
+	mtx_unlock(&count->lock);
+
+	for (;;) {
+		mtx_lock(&count->lock);
+		while (count->pendingCount == 0 && count->busy > 0 && !count->failed) {
+			cnd_wait(&count->changed, &count->lock);  // Sleep until a search ends, which may leave more to do
+		}
+		if (count->pendingCount == 0 || count->failed) {
+			mtx_unlock(&count->lock);
+			break;  // Nothing pending and nothing being searched that could add more
+		}
+		strcpy(count->searching[thread], count->pending[--count->pendingCount]);
+		count->busy++;
+		mtx_unlock(&count->lock);
+
+		parseBoard(count->searching[thread], board);
+		unsigned long long startNodes = backtrackCount;
+		int solutions = solverCount(solver, board, solution, NO_LIMIT);
+
+		mtx_lock(&count->lock);
+		count->solutions += solutions;
+		count->nodes += backtrackCount - startNodes;
+		spillPending(count, solver, board);
+		count->searching[thread][0] = '\0';
+		count->busy--;
+		cnd_broadcast(&count->changed);
+		if (count->checkpointPath[0] && secondsNow() - count->lastCheckpoint >= CHECKPOINT_SECONDS) {
+			saveCount(count);
+		}
+		mtx_unlock(&count->lock);
+	}
+	return 0;
+}
+
+/* Split a board into units for runCount(): the boards made by filling the cells that chooseBranch() would
+ * branch on, one level at a time, until there are at least COUNT_UNITS of them or nothing left to fill.
+ * Dead ends are dropped and full boards stay as units of one solution, so the solutions of the units add up to
+ * the solutions of the board. The split only depends on the board.
+ *
+ * Returns the number of units, stored in *units (to be freed by the caller), or -1 if out of memory
+ */
+int splitIntoUnits(int board[][GRID_WIDTH], char (**units)[GRID_CELLS + 1]) {
+	int work[GRID_WIDTH][GRID_WIDTH];
+	DigitMask candidates[GRID_CELLS];
+	char (*level)[GRID_CELLS + 1] = malloc(sizeof(*level));
+	int levelCount = 1;
+	int expanded = TRUE;
+
+	if (level == NULL) {
+		return -1;
+	}
+	formatBoard(board, level[0]);
+	while (levelCount < COUNT_UNITS && expanded) {
+		char (*next)[GRID_CELLS + 1] = malloc((size_t)levelCount * SIZE * sizeof(*next));
+		int nextCount = 0;
+		if (next == NULL) {
+			free(level);
+			return -1;
+		}
+		expanded = FALSE;
+		for (int i = 0; i < levelCount; i++) {
+			int cell;
+			DigitMask values;
+			parseBoard(level[i], work);
+			if (!chooseBranch(work, candidates, &cell, &values)) {
+				strcpy(next[nextCount++], level[i]);  // Already full
+				continue;
+			}
+			for (int value = 1; value <= SIZE; value++) {
+				if (values & ((DigitMask)1 << value)) {
+					(&work[0][0])[cell] = value;
+					formatBoard(work, next[nextCount++]);
+					expanded = TRUE;
+				}
+			}
+		}
+		free(level);
+		level = next;
+		levelCount = nextCount;
+	}
+	*units = level;
+	return levelCount;
+}
+
+/* Add a subproblem to the pending list of a count, with the lock held.
+ * Returns FALSE (and marks the count failed) if the list couldn't grow
+ */
+int addPending(SolutionCount* count, const char text[GRID_CELLS + 1]) {
+	if (count->pendingCount == count->pendingSize) {
+		int size = count->pendingSize ? 2 * count->pendingSize : 1024;
+		char (*pending)[GRID_CELLS + 1] = realloc(count->pending, (size_t)size * sizeof(*pending));
+		if (pending == NULL) {
+			count->failed = TRUE;
+			return FALSE;
+		}
+		count->pending = pending;
+		count->pendingSize = size;
+	}
+	strcpy(count->pending[count->pendingCount++], text);
+	return TRUE;
+}
+
+/* Turn the moves left untried by a paused search into pending subproblems, with the lock held.
+ * Level k of the stack holds the moves still to try in its cell, on the board with the moves of the levels
+ * below it made, so each becomes one subproblem. The deepest levels are added last to be searched first.
+ */
+void spillPending(SolutionCount* count, SolverContext* solver, int board[][GRID_WIDTH]) {
+	int* cells = &board[0][0];
+	int path[GRID_CELLS + 1];  // The integer placed at each level, EMPTY if none
+	char text[GRID_CELLS + 1];
+
+	// Take the board back to the root of the search, keeping the path of moves
+	for (int k = 0; k < solver->depth; k++) {
+		path[k] = solver->stack[k].placed ? cells[solver->stack[k].cell] : EMPTY;
+		cells[solver->stack[k].cell] = EMPTY;
+	}
+	for (int k = 0; k < solver->depth; k++) {
+		SolverFrame* frame = &solver->stack[k];
+		for (int value = 1; value <= SIZE; value++) {
+			if (frame->untried & ((DigitMask)1 << value)) {
+				cells[frame->cell] = value;
+				formatBoard(board, text);
+				addPending(count, text);
+			}
+		}
+		cells[frame->cell] = path[k];  // The levels above were reached through this move
+	}
+}
+
+/* Save a count to its checkpoint file, with the lock held (or while no thread is running).
+ * The subproblems being searched are saved with the pending ones, since none of their solutions have been
+ * added yet, and last so that a resumed count takes them first. The file is written under a temporary name
+ * and renamed over the old checkpoint once complete.
+ *
+ * Returns TRUE if the checkpoint was saved
+ */
+int saveCount(SolutionCount* count) {
+	char temporaryPath[MAX_PATH_LENGTH + 4];
+	FILE* checkpoint;
+	int searching = 0;
+
+	for (int t = 0; t < count->nextThread; t++) {
+		searching += (count->searching[t][0] != '\0');
+	}
+	sprintf(temporaryPath, "%s.tmp", count->checkpointPath);
+	checkpoint = fopen(temporaryPath, "w");
+	if (checkpoint == NULL) {
+		fprintf(stderr, "Can't write the checkpoint %s\n", temporaryPath);
+		return FALSE;
+	}
+	fprintf(checkpoint, "sudokuPuzzles count checkpoint\nsize %d variant %d\nboard %s\nunits %d %d\n"
+		"solutions %llu\nnodes %llu\npending %d\n", SIZE, VARIANT, count->board, count->firstUnit, count->lastUnit,
+		count->solutions, count->nodes, count->pendingCount + searching);
+	for (int i = 0; i < count->pendingCount; i++) {
+		fprintf(checkpoint, "%s\n", count->pending[i]);
+	}
+	for (int t = 0; t < count->nextThread; t++) {
+		if (count->searching[t][0] != '\0') {
+			fprintf(checkpoint, "%s\n", count->searching[t]);
+		}
+	}
+	int written = !ferror(checkpoint);
+	written = (fclose(checkpoint) == 0) && written;
+
+#if defined(_WIN32)
+	remove(count->checkpointPath);  // rename() doesn't replace an existing file on Windows
+#endif
+	if (!written || rename(temporaryPath, count->checkpointPath) != 0) {
+		fprintf(stderr, "Can't save the checkpoint %s\n", count->checkpointPath);
+		return FALSE;
+	}
+	count->lastCheckpoint = secondsNow();
+	return TRUE;
+}
+
+/* Resume a count from its checkpoint file, which must be for the same build, board and unit range.
+ * Returns 1 if the count was restored, 0 if there is no checkpoint yet, -1 (with a message) if it can't be used
+ */
+int loadCount(SolutionCount* count) {
+	FILE* checkpoint = fopen(count->checkpointPath, "r");
+	char board[GRID_CELLS + 1];
+	char format[32];
+	int size, variant, firstUnit, lastUnit, pendingCount;
+	unsigned long long solutions, nodes;
+
+	if (checkpoint == NULL) {
+		return 0;
+	}
+	sprintf(format, "%%%ds", GRID_CELLS);  // Reads one board of text
+	int valid = fscanf(checkpoint, " sudokuPuzzles count checkpoint size %d variant %d board", &size, &variant) == 2
+		&& fscanf(checkpoint, format, board) == 1
+		&& fscanf(checkpoint, " units %d %d solutions %llu nodes %llu pending %d", &firstUnit, &lastUnit,
+			&solutions, &nodes, &pendingCount) == 5
+		&& size == SIZE && variant == VARIANT && strcmp(board, count->board) == 0 && firstUnit == count->firstUnit
+		&& (count->lastUnit < 0 || lastUnit == count->lastUnit) && pendingCount >= 0;
+	for (int i = 0; valid && i < pendingCount; i++) {
+		valid = fscanf(checkpoint, format, board) == 1 && strlen(board) == GRID_CELLS && addPending(count, board);
+	}
+	fclose(checkpoint);
+	if (!valid) {
+		fprintf(stderr, "%s is not a checkpoint of this count (same build, board and units)\n", count->checkpointPath);
+		return -1;
+	}
+
+	count->lastUnit = lastUnit;
+	count->solutions = solutions;
+	count->nodes = nodes;
+	fprintf(stderr, "Resuming from %s: %llu solutions so far, %d subproblems pending\n", count->checkpointPath,
+		solutions, pendingCount);
+	return 1;
+}
+
+/* Write a board as one line of text, see cellChars */
+void formatBoard(int board[][GRID_WIDTH], char text[GRID_CELLS + 1]) {
+	const int* cells = &board[0][0];
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		text[cell] = rules.active[cell] ? cellChars[cells[cell]] : INACTIVE_CHAR;
+	}
+	text[GRID_CELLS] = '\0';
+}
+
+/* Read a board from one line of text as written by formatBoard(), 0 is also taken for an empty cell.
+ * Returns FALSE if the text is not a board of this size and variant
+ */
+int parseBoard(const char* text, int board[][GRID_WIDTH]) {
+	int* cells = &board[0][0];
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		const char* found = text[cell] != '\0' ? strchr(cellChars, text[cell]) : NULL;
+		if (!rules.active[cell]) {
+			if (text[cell] != INACTIVE_CHAR) {
+				return FALSE;
+			}
+			cells[cell] = EMPTY;
+		}
+		else if (text[cell] == '0') {
+			cells[cell] = EMPTY;
+		}
+		else if (found != NULL && found - cellChars <= SIZE) {
+			cells[cell] = (int)(found - cellChars);
+		}
+		else {
+			return FALSE;
+		}
+	}
+	return text[GRID_CELLS] == '\0' || text[GRID_CELLS] == '\n' || text[GRID_CELLS] == '\r';
+}
+
+/* Duplicates a Sudoku board value for value reading from read[][], writing to write[][]*/
+void duplicateBoard(int read[][GRID_WIDTH], int write[][GRID_WIDTH]) {
+
+	for (int i = 0; i < GRID_WIDTH; i++) {
+		for (int j = 0; j < GRID_WIDTH; j++) {
+			write[i][j] = read[i][j];
+		}
+	}
+}
+
+/* Displays a formatted rendering of the Sudoku board for viewing in the console
+ * Formatting lines indicate the sub-square boundaries, JIGSAW boards have no sub-squares and are printed without them
+ * Inactive cells of a SAMURAI board are left blank
+ */
+void printBoard(int board[][GRID_WIDTH]) {
+
+	// Calculate the length of a subsquare (number of positions)
+	int subSquareLength = (rules.variant == JIGSAW) ? GRID_WIDTH : (int)sqrt(SIZE);
+
+	for (int i = 0; i < GRID_WIDTH; i++) {
+
+		//This section inserts a horizontal line of suitable length to visually divide the subsquares
+		if (i % subSquareLength == 0 && i > 0) {    // Determine if a horizontal line should be inserted
+			for (int space = 0; space < GRID_WIDTH; space++) {  //Fill it with dashes
+				printf("---");
+			}
+			//Add extra dashes to account for the vertical sub-square lines inserted
+			for (int space = 0; space < GRID_WIDTH / subSquareLength - 1; space++) {  
+				printf("---");
+			}
+			printf("\n"); // Line break to start new row
+		}
+
+		// The numerical values are filled in with vertical line breaks for each subsquare division
+		for (int j = 0; j < GRID_WIDTH; j++) {
+			if (j % subSquareLength == 0 && j > 0) {  // Determine if vertical line needed
+				printf("  |");
+			}
+			if (rules.active[i * GRID_WIDTH + j]) {
+				printf("%3d", board[i][j]);
+			}
+			else {
+				printf("   ");
+			}
+		}
+
+		printf("\n");  // Line break to start new row
+	}
+}
+
+/* Displays the Killer cages of the global rules: a map of the cage letters on the board
+ * followed by the sum of every cage
+ */
+void printCages(void) {
+	for (int i = 0; i < GRID_WIDTH; i++) {
+		for (int j = 0; j < GRID_WIDTH; j++) {
+			int cage = rules.cageOf[i * GRID_WIDTH + j];
+			if (cage == NO_CAGE) {
+				printf("    ");
+				continue;
+			}
+			printf("%3c%c", 'A' + cage % 26, cage >= 26 ? '0' + (cage / 26) % 10 : ' ');
+		}
+		printf("\n");
+	}
+	printf("\n");
+	for (int cage = 0; cage < rules.cageCount; cage++) {
+		printf("%c%c=%-4d%s", 'A' + cage % 26, cage >= 26 ? '0' + (cage / 26) % 10 : ' ', rules.cageSum[cage],
+			(cage % 8 == 7) ? "\n" : " ");
+	}
+	printf("\n");
+}
+
+/* Given an array of Sudoku values, this function will return total number of solutions, 0 if a solution has not been found
+ * It searches with backtracking.  Finds the next empty cell to fill in the array and
+ * tries all possible combinations with it.  Returns 0 if no solution exists.
+ */
+int solveBoard(int board[][GRID_WIDTH], int solution[][GRID_WIDTH]) {
+	return countSolutions(board, solution, NO_LIMIT);
+}
+
+/* Count the solutions of a board like solveBoard(), but stop searching as soon as limit solutions have been
+ * found (NO_LIMIT counts them all). A limit of 2 is all a uniqueness check needs, and spares it the work of
+ * enumerating every solution of a board with many empty cells. The last solution found is saved to solution.
+ * The search runs in the calling thread's own solver context, set up the first time it is needed.
+ */
+int countSolutions(int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit) {
+
+	if (threadSolver == NULL) {
+		threadSolver = solverInit(threadSolverWorkspace, sizeof(threadSolverWorkspace), GRID_CELLS);
+	}
+	PERF_BEGIN(PHASE_UNIQUE);
+	TRACE_BEGIN("solveBoard");
+	int solutions = solverCount(threadSolver, board, solution, limit);
+	TRACE_END();
+	PERF_END(NULL);
+	return solutions;
+}
+
+/* The number of bytes of workspace a solver context needs to search boards with up to emptyCells empty cells */
+size_t solverWorkspaceSize(int emptyCells) {
+	return ARENA_ROUND(sizeof(SolverContext)) + ARENA_ROUND((emptyCells + 1) * sizeof(SolverFrame))
+		+ ARENA_ROUND(GRID_CELLS * sizeof(DigitMask));
+}
+
+/* Set up a solver context inside workspace, a block of at least solverWorkspaceSize(emptyCells) bytes aligned
+ * to ARENA_ALIGN that the caller owns. The context lives in the workspace itself, so it stays usable for as
+ * long as the block does and is never freed separately.
+ *
+ * Returns the context, or NULL if the workspace is too small
+ */
+SolverContext* solverInit(void* workspace, size_t workspaceSize, int emptyCells) {
+	unsigned char* next = (unsigned char*)workspace;
+
+	if (workspace == NULL || emptyCells < 0 || workspaceSize < solverWorkspaceSize(emptyCells)) {
+		return NULL;
+	}
+	SolverContext* solver = (SolverContext*)next;
+	next += ARENA_ROUND(sizeof(SolverContext));
+	solver->stackSize = emptyCells + 1;
+	solver->stack = (SolverFrame*)next;
+	next += ARENA_ROUND((emptyCells + 1) * sizeof(SolverFrame));
+	solver->candidates = (DigitMask*)next;
+	return solver;
+}
+
+/* Count the solutions of a board up to limit (NO_LIMIT counts them all) in the memory of a solver context.
+ * The same depth-first search as the recursive definition in solveBoard(), with the levels kept on the
+ * context's stack: each level holds a cell and the integers not yet tried in it, and the board itself is
+ * the only other state, restored on the way back up. The last solution found is saved to solution.
+ *
+ * With a nodeLimit set in the context the search pauses after that many moves, leaving the moves still to try
+ * in solver->depth levels of the stack and the cells of the current path filled in on the board (see
+ * spillPending()). solver->depth is 0 when the search ran to the end.
+ *
+ * Returns the number of solutions found, or -1 if the board has more empty cells than the context has room for
+ */
+int solverCount(SolverContext* solver, int board[][GRID_WIDTH], int solution[][GRID_WIDTH], int limit) {
+	int* cells = &board[0][0];  // The board viewed as a flat list of cells
+	int totalSolutions = 0;
+	int depth = 0;              // The number of levels on the stack
+	long long nodes = 0;        // The moves made, for pausing at nodeLimit
+	PROFILE(SearchProfile* profile = threadProfile != NULL ? threadProfile : searchProfile());
+
+	solver->depth = 0;
+	PROFILE(profile->searches++);
+
+	// The root level, or the answer straight away for a full board or a dead end
+	if (!chooseBranch(board, solver->candidates, &solver->stack[0].cell, &solver->stack[0].untried)) {
+		duplicateBoard(board, solution);
+		return 1;
+	}
+	solver->stack[0].placed = FALSE;
+	PROFILE(profile->branching[countDigits(solver->stack[0].untried)]++);
+	depth = 1;
+
+	while (depth > 0) {
+		SolverFrame* frame = &solver->stack[depth - 1];
+
+		if (frame->placed) {  // Back from the move tried last at this level
+			cells[frame->cell] = EMPTY;
+			frame->placed = FALSE;
+			backtrackCount++;  // track how many nodes visited
+		}
+		if (frame->untried == 0 || (limit != NO_LIMIT && totalSolutions >= limit)) {
+			depth--;  // Every move of this level is done, or enough solutions have been found
+			continue;
+		}
+		if (solver->nodeLimit != 0 && nodes++ >= solver->nodeLimit) {
+			solver->depth = depth;  // Pause with the untried moves left on the stack
+			return totalSolutions;
+		}
+
+		// Make the next move, the integers are tried in increasing order
+		DigitMask digit = frame->untried & (~frame->untried + 1);
+		frame->untried &= ~digit;
+		cells[frame->cell] = countDigits(digit - 1);  // The bit index is the integer
+		frame->placed = TRUE;
+
+		if (depth == solver->stackSize) {
+			cells[frame->cell] = EMPTY;  // Too deep for the context, undo every move before giving up
+			while (--depth > 0) {
+				cells[solver->stack[depth - 1].cell] = EMPTY;
+			}
+			return -1;
+		}
+		PROFILE(profile->nodes++);
+		PROFILE(profile->depthNodes[depth]++);
+		PROFILE(profile->cellNodes[frame->cell]++);
+		SolverFrame* child = &solver->stack[depth];
+		if (!chooseBranch(board, solver->candidates, &child->cell, &child->untried)) {
+			duplicateBoard(board, solution);  // No more empty cells, the board has been solved
+			totalSolutions++;
+			PROFILE(profile->solutions[depth]++);
+		}
+		else if (child->untried != 0) {
+			child->placed = FALSE;
+			PROFILE(profile->branching[countDigits(child->untried)]++);
+			depth++;
+		}
+		else {
+			PROFILE(profile->deadEnds[depth]++);
+			PROFILE(profile->branching[0]++);
+		}
+	}
+	return totalSolutions;
+}
+
+/* Find the x and y coordinate values of the next empty position to fill in the Sudoku board.
+ * The empty cell with the fewest legal integers is chosen, so that dead ends are found as early as possible
+ * and forced cells are filled without branching. Ties go to the first such cell in row by row order.
+ * if there are no more empty positions, then the function returns FALSE (puzzle has been solved).
+ * otherwise the coordinates are returned by array { xValue, yValue }
+ */
+int nextEmpty(int board[][GRID_WIDTH], int* add_xVal, int* add_yVal) {
+	const int* cells = &board[0][0];  // The board viewed as a flat list of cells
+	int found = FALSE;  //Tracks if an empty value has been found yet
+	int bestCell = 0;   // The most constrained empty cell found so far
+	int bestCount = SIZE + 1;  // The number of legal integers of bestCell
+
+	// Scan every cell, stop early on a cell with one or no options since nothing can beat it
+	for (int cell = 0; cell < GRID_CELLS && bestCount > 1; cell++) {
+		if (cells[cell] == EMPTY && rules.active[cell]) {
+			int count = countDigits(candidateMask(board, cell % GRID_WIDTH, cell / GRID_WIDTH));
+			if (count < bestCount) {
+				bestCount = count;
+				bestCell = cell;
+				found = TRUE;
+			}
+		}
+	}
+
+	// Pass by pointer the values to the calling function
+	if (found) {
+		*add_xVal = bestCell % GRID_WIDTH;
+		*add_yVal = bestCell / GRID_WIDTH;
+	}
+	return found;
+}
+
+/* Choose the moves to branch on from a board: one cell and the integers to try in it.
+ * Every solution of the board makes exactly one of the moves, so the solutions of the alternatives add up
+ * to the solutions of the board.
+ *  - If a region is missing an integer that none of its empty cells can take, there are no moves (dead end)
+ *  - If an integer has a single possible cell left in a region (hidden single), that is the only move
+ *  - Otherwise the moves are the legal integers of the empty cell with the fewest of them
+ * candidates[] is scratch space for the legal integers of every empty cell.
+ *
+ * Returns FALSE if the board has no empty cell, otherwise TRUE with the cell in branchCell and the integers
+ * of its moves in branchValues (no integers for a dead end)
+ */
+int chooseBranch(int board[][GRID_WIDTH], DigitMask candidates[GRID_CELLS], int* branchCell, DigitMask* branchValues) {
+	const int* cells = &board[0][0];  // The board viewed as a flat list of cells
+	int bestCell = -1;                 // The empty cell with the fewest legal integers
+	int bestCount = SIZE + 1;
+
+	for (int cell = 0; cell < GRID_CELLS; cell++) {
+		if (cells[cell] == EMPTY && rules.active[cell]) {
+			candidates[cell] = candidateMask(board, cell % GRID_WIDTH, cell / GRID_WIDTH);
+			int count = countDigits(candidates[cell]);
+			if (count < bestCount) {
+				bestCount = count;
+				bestCell = cell;
+				if (count == 0) {
+					*branchCell = cell;  // A cell without a legal integer, no solution from here
+					*branchValues = 0;
+					return TRUE;
+				}
+			}
+		}
+	}
+	if (bestCell < 0) {
+		return FALSE;  // The board is full
+	}
+
+	if (bestCount > 1) {
+		/* Look for hidden singles. For each region, seenOnce holds the integers possible in at least one of its
+		 * empty cells and seenTwice those possible in at least two, so seenOnce & ~seenTwice are hidden singles
+		 */
+		for (int region = 0; region < rules.regionCount; region++) {
+			DigitMask placed = 0;
+			DigitMask seenOnce = 0;
+			DigitMask seenTwice = 0;
+			for (int k = 0; k < SIZE; k++) {
+				int cell = rules.regionCells[region][k];
+				if (cells[cell] == EMPTY) {
+					seenTwice |= seenOnce & candidates[cell];
+					seenOnce |= candidates[cell];
+				}
+				else {
+					placed |= (DigitMask)1 << cells[cell];
+				}
+			}
+			if (ALL_DIGITS & ~placed & ~seenOnce) {
+				*branchCell = bestCell;  // An integer has nowhere to go in this region
+				*branchValues = 0;
+				return TRUE;
+			}
+			DigitMask single = seenOnce & ~seenTwice;
+			if (single) {
+				DigitMask digit = single & (~single + 1);  // The lowest hidden single
+				for (int k = 0; k < SIZE; k++) {
+					int cell = rules.regionCells[region][k];
+					if (cells[cell] == EMPTY && (candidates[cell] & digit)) {
+						*branchCell = cell;
+						*branchValues = digit;
+						return TRUE;
+					}
+				}
+			}
+		}
+	}
+
+	// Branch on every legal integer of the most constrained cell
+	*branchCell = bestCell;
+	*branchValues = candidates[bestCell];
+	return TRUE;
+}
+
+/* Populate a list of all possible legal integers to fill a Sudoku cell based on the surrounding values of the cell
+ * Inputs: - board - a Sudoku board
+ *		   - xPos, yPos - The coordinates of the Sudoku cell to be inspected
+ *         - validIntegers - The array to store the list of values in
+ *
+ * Output: - (implicit) The values are stored in validIntegers which can be accessed by the calling function
+ *	       - intIndex - The total number of valid integer options found for the Sudoku cell, returns 0 if no legal moves
+ */		   
+
+int getValidIntegers(int board[][GRID_WIDTH], int xPos, int yPos, int validIntegers[SIZE]) {
+	/* The set of legal integers for the cell, each set bit index is an integer that can be
+	 * substituted into the cell without repeating a value in any of its regions
+	 */
+	DigitMask candidates = candidateMask(board, xPos, yPos);
+
+	int intIndex = 0;     // Start at 0 index for the array of integer values
+	for (int value = 1; value <= SIZE; value++) {  // Scan all bits of the set in increasing order
+		if (candidates & ((DigitMask)1 << value)) {
+			validIntegers[intIndex] = value;
+			intIndex++;
+		}
+	}
+
+	return intIndex; // The total number of valid integers is equal the final value of intIndex
+}
+
+/* Inspects a cell on a Sudoku board and verifies which integer values might be permitted in that Sudoku cell
+ * Checks every region of that Sudoku cell to remove invalid integer options 
+ * Input : board - a solved or unsolved Sudoku board
+ *         coords - the coordinates of the Sudoku cell to be inspected
+ *         permitted - an array of TRUE or FALSE values that will record and return results
+					   The array represents valid integer options as yielding a TRUE value at
+					   the index of that integer.
+ *
+ * Output : (implicit) permitted[] -  records which integers can be legally substituted into a board position
+ *          the integer of the array index position is the integer value in question, TRUE means it is permitted
+ */         
+
+void permittedValue(int board[][GRID_WIDTH], int xPos, int yPos, int permitted[SIZE+1]) {
+	DigitMask candidates = candidateMask(board, xPos, yPos);
+
+	permitted[EMPTY] = FALSE; // The 0 EMPTY cell value is not a legal option
+	for (int i = 1; i < SIZE + 1; i++) {
+		permitted[i] = (candidates >> i) & 1;
+	}
+}
+
+/* Compute the set of integers that can be legally placed in a cell as a DigitMask.
+ * Every filled peer of the cell knocks its integer out of the set; an EMPTY peer only touches bit 0
+ * which is never part of the result, so no test for empty cells is needed in the loop.
+ */
+DigitMask candidateMask(int board[][GRID_WIDTH], int xPos, int yPos) {
+	const int* cells = &board[0][0];  // The board viewed as a flat list of cells numbered row by row
+	int cell = yPos * GRID_WIDTH + xPos;
+	DigitMask used = 0;
+
+	for (int i = 0; i < rules.peerCount[cell]; i++) {
+		used |= (DigitMask)1 << cells[rules.peers[cell][i]];
+	}
+
+	if (rules.cageOf[cell] != NO_CAGE) {  // A Killer cage further limits the integers to those that reach its sum
+		return ALL_DIGITS & ~used & cageCandidates(board, rules.cageOf[cell]);
+	}
+	return ALL_DIGITS & ~used;
+}
+
+/* Compute the set of integers that can still go into the empty cells of a Killer cage.
+ * The remaining sum and number of empty cells of the cage select a slice of the sum-combination tables,
+ * and every set in the slice that avoids the integers already in the cage contributes its integers.
+ */
+DigitMask cageCandidates(int board[][GRID_WIDTH], int cage) {
+	const int* cells = &board[0][0];
+	int remainingSum = rules.cageSum[cage];
+	int emptyCount = 0;
+	DigitMask used = 0;
+	DigitMask candidates = 0;
+
+	for (int k = 0; k < rules.cageSize[cage]; k++) {
+		int value = cells[rules.cageCells[cage][k]];
+		if (value == EMPTY) {
+			emptyCount++;
+		}
+		else {
+			remainingSum -= value;
+			used |= (DigitMask)1 << value;
+		}
+	}
+
+	if (remainingSum < 0 || remainingSum > MAX_SUM) {
+		return 0;  // The placed integers already overshoot the cage sum
+	}
+	for (int i = cageTables.comboStart[emptyCount][remainingSum]; i < cageTables.comboStart[emptyCount][remainingSum + 1]; i++) {
+		if (!(cageTables.comboMasks[i] & used)) {
+			candidates |= cageTables.comboMasks[i];
+		}
+	}
+	return candidates;
+}
+
+/* Count the number of integers in a DigitMask */
+int countDigits(DigitMask digits) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcount(digits);
+#else
+	int count = 0;
+	while (digits) {
+		digits &= digits - 1;  // Clear the lowest set bit
+		count++;
+	}
+	return count;
+#endif
+}
+
+/* Seed the random number generator of the calling thread */
+void seedRandom(unsigned long long seed) {
+	randomState = seed;
+}
+
+/* The seed of one of many independent random sequences drawn from one seed, e.g. one per worker or puzzle.
+ * The stream number is mixed in rather than added: splitmix64 steps its state by a fixed constant, so seeds a
+ * multiple of that constant apart would give the same sequence shifted by a few draws.
+ */
+unsigned long long streamSeed(unsigned long long seed, unsigned long long stream) {
+	unsigned long long z = seed ^ (stream * 0xD6E8FEB86659FD93ULL + 0x632BE59BD9B4E019ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* Draw a pseudo-random integer from 0 to range - 1 with the generator of the calling thread (splitmix64).
+ * Each thread has its own state, so threads never share or disturb each other's sequence.
+ */
+int randomInt(int range) {
+	unsigned long long z = (randomState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return (int)(z % (unsigned long long)range);
+}
+
+/* Take an ordered list of integers and shuffle the values into a randomly ordered list 
+ * A list is defined as a string of integers of size listSize, with the last item of the
+ * placed at index [listSize - 1] since the list items start at index 0.
+ *
+ */
+void shuffleValues(int list[SIZE], int listSize) {
+
+	int randomIndex; // A randomly selected index 
+	int completedIndex = 0; // The index of items that have been successfully shuffled
+	int listItem;  // The current list item selected in the shuffling process
+
+	do {
+		//Select a random index that covers the first listSize number of items in the array
+		randomIndex = randomInt(listSize);
+
+		// Use the random index to draw one item from the list
+		listItem = list[randomIndex];
+
+		/* Scratch the value from the list
+		 * Start at the randomIndex and overwrite each value in the list with the
+		 * next value in the list
+		 */
+		for (int i = randomIndex; i < listSize - 1; i++) {
+			list[i] = list[i + 1];
+		}
+
+		// Reduce the unshuffled listSize by one since an item is removed
+		listSize--;
+
+		// Place the removed list item back in the array in the newly vacated spot
+		list[listSize] = listItem;
+
+		// Increment completedIndex, an item was added to the shuffled deck
+		completedIndex++;
+
+	} while (listSize > 0); //Continue until the entire list is shuffled
+}
+